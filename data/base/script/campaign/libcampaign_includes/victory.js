@@ -126,6 +126,16 @@ function camSetStandardWinLossConditions(kind, nextLevel, data)
 	__camNextLevel = nextLevel;
 }
 
+//Start reading the next level once the end of this one is near, so it does not
+//sit in memory for the whole mission.
+function __camPrefetchNextLevel()
+{
+	if (camDef(__camNextLevel) && __camNextLevel !== "GAMMA_OUT")
+	{
+		prefetchLevel(__camNextLevel);
+	}
+}
+
 //Checks for extra win conditions defined in level scripts, if any.
 function camCheckExtraObjective()
 {
@@ -165,6 +175,7 @@ function __camGameLost()
 function __camGameWon()
 {
 	__camLevelEnded = true;
+	camCallOnce("__camPrefetchNextLevel");
 	if (camDef(__camVictoryData) && camDef(__camVictoryData.victoryVideo))
 	{
 		camPlayVideos(__camVictoryData.victoryVideo);
@@ -265,6 +276,7 @@ function __camTriggerLastAttack()
 		camTrace(enemies.length, "enemy droids remaining");
 		camManageGroup(camMakeGroup(enemies), CAM_ORDER_ATTACK);
 		__camLastAttackTriggered = true;
+		camCallOnce("__camPrefetchNextLevel");
 	}
 }
 
@@ -309,6 +321,10 @@ function __camVictoryTimeout()
 		__camGameLost();
 		return;
 	}
+	if (getMissionTime() < camMinutesToSeconds(1))
+	{
+		camCallOnce("__camPrefetchNextLevel");
+	}
 	// victory hooked from eventMissionTimeout
 }
 
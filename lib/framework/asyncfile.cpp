@@ -0,0 +1,533 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2005-2020  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file asyncfile.cpp
+ *  Reading whole files on a small pool of I/O threads.
+ */
+
+#include "frame.h"
+#include "asyncfile.h"
+#include "physfs_ext.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#define ASYNCFILE_THREADS       2                       ///< Number of I/O threads, more don't help much on a single disk
+#define ASYNCFILE_POOL_BUFFERS  8                       ///< Number of free buffers kept for reuse
+#define ASYNCFILE_POOL_MAX_SIZE (8 * 1024 * 1024)       ///< Bigger buffers are freed instead of kept for reuse
+#define ASYNCFILE_READAHEAD_MAX_SIZE (64 * 1024 * 1024) ///< Memory held by files read ahead but not taken yet
+#define ASYNCFILE_MAX_TIMINGS   10000                   ///< Number of reads remembered for asyncFileLogTimings
+#define ASYNCFILE_LOG_SLOWEST   10                      ///< Number of reads listed by asyncFileLogTimings
+
+namespace
+{
+	struct FileTiming
+	{
+		std::string fileName;
+		size_t size;
+		uint64_t queuedMicroseconds;    ///< Time between the request and an I/O thread starting on it
+		uint64_t readMicroseconds;
+	};
+}
+
+typedef std::chrono::steady_clock Clock;
+typedef wz::packaged_task<AsyncFileResult()> AsyncFileJob;
+
+namespace
+{
+	struct ReadAheadFile
+	{
+		AsyncFileHandle handle;
+		unsigned generation;    ///< readAheadGeneration when queued. Older ones may have been skipped, so are read again.
+	};
+}
+
+// threading stuff
+static std::vector<wz::thread>  ioThreads;
+static WZ_SEMAPHORE             *ioSemaphore = nullptr;         ///< Posted once per job, and once per thread to quit
+static wz::mutex                ioMutex;                        ///< Protects everything down to readAheadFiles
+static std::list<AsyncFileJob>  ioJobs;
+static unsigned                 ioActiveJobs = 0;
+static bool                     ioQuit = false;
+static bool                     waitingForIdle = false;
+static WZ_SEMAPHORE             *idleSemaphore = nullptr;
+static std::map<std::string, ReadAheadFile> readAheadFiles;
+static std::atomic<unsigned>    readAheadGeneration(0);         ///< Read-aheads queued in an earlier generation are skipped
+static std::atomic<size_t>      readAheadBytes(0);              ///< Size of the read-ahead results not freed yet
+
+static wz::mutex                poolMutex;
+static std::vector<std::pair<char *, size_t>> bufferPool;       ///< Free buffers and their capacity
+
+static wz::mutex                timingMutex;
+static std::vector<FileTiming>  fileTimings;
+
+
+AsyncFileBuffer::AsyncFileBuffer(AsyncFileBuffer &&other)
+	: pData(other.pData)
+	, dataSize(other.dataSize)
+	, capacity(other.capacity)
+{
+	other.pData = nullptr;
+	other.dataSize = 0;
+	other.capacity = 0;
+}
+
+AsyncFileBuffer::~AsyncFileBuffer()
+{
+	if (pData == nullptr)
+	{
+		return;
+	}
+	if (capacity <= ASYNCFILE_POOL_MAX_SIZE)
+	{
+		std::lock_guard<wz::mutex> lock(poolMutex);
+		if (bufferPool.size() < ASYNCFILE_POOL_BUFFERS)
+		{
+			bufferPool.emplace_back(pData, capacity);
+			return;
+		}
+	}
+	free(pData);
+}
+
+AsyncFileBuffer &AsyncFileBuffer::operator =(AsyncFileBuffer &&other)
+{
+	std::swap(pData, other.pData);
+	std::swap(dataSize, other.dataSize);
+	std::swap(capacity, other.capacity);
+	return *this;
+}
+
+char *AsyncFileBuffer::release()
+{
+	char *ret = pData;
+	pData = nullptr;
+	dataSize = 0;
+	capacity = 0;
+	return ret;
+}
+
+AsyncFileBuffer AsyncFileBuffer::allocate(size_t size)
+{
+	AsyncFileBuffer buffer;
+	buffer.dataSize = size;
+	{
+		std::lock_guard<wz::mutex> lock(poolMutex);
+		// Use the smallest free buffer which is big enough.
+		auto best = bufferPool.end();
+		for (auto i = bufferPool.begin(); i != bufferPool.end(); ++i)
+		{
+			if (i->second > size && (best == bufferPool.end() || i->second < best->second))
+			{
+				best = i;
+			}
+		}
+		if (best != bufferPool.end())
+		{
+			buffer.pData = best->first;
+			buffer.capacity = best->second;
+			bufferPool.erase(best);
+		}
+	}
+	if (buffer.pData == nullptr)
+	{
+		buffer.capacity = size + 1;
+		buffer.pData = (char *)malloc(buffer.capacity);
+	}
+	buffer.pData[size] = '\0';
+	return buffer;
+}
+
+
+static uint64_t microsecondsBetween(Clock::time_point start, Clock::time_point end)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+static void recordTiming(FileTiming &&timing)
+{
+	std::lock_guard<wz::mutex> lock(timingMutex);
+	if (fileTimings.size() < ASYNCFILE_MAX_TIMINGS)
+	{
+		fileTimings.push_back(std::move(timing));
+	}
+}
+
+/// Gets the current size and modification time of the file.
+static bool currentFileStamp(const char *fileName, int64_t *size, int64_t *modTime)
+{
+#if defined(WZ_PHYSFS_2_1_OR_GREATER)
+	PHYSFS_Stat metaData;
+	if (!PHYSFS_stat(fileName, &metaData) || metaData.filetype != PHYSFS_FILETYPE_REGULAR)
+	{
+		return false;
+	}
+	*size = metaData.filesize;
+	*modTime = metaData.modtime;
+#else
+	PHYSFS_file *fileHandle = PHYSFS_openRead(fileName);
+	if (fileHandle == nullptr)
+	{
+		return false;
+	}
+	*size = PHYSFS_fileLength(fileHandle);
+	PHYSFS_close(fileHandle);
+	*modTime = WZ_PHYSFS_getLastModTime(fileName);
+#endif
+	return true;
+}
+
+/// Reads the file, on an I/O thread, or on the calling thread if there are none.
+static AsyncFileResult readWholeFile(std::string const &fileName, Clock::time_point queued)
+{
+	AsyncFileResult result;
+	const Clock::time_point start = Clock::now();
+
+	const char *realDir = PHYSFS_getRealDir(fileName.c_str());
+	PHYSFS_file *fileHandle = realDir != nullptr ? PHYSFS_openRead(fileName.c_str()) : nullptr;
+	if (fileHandle == nullptr)
+	{
+		return result;
+	}
+	result.realDir = realDir;
+	result.modTime = WZ_PHYSFS_getLastModTime(fileName.c_str());
+
+	PHYSFS_sint64 fileSize = PHYSFS_fileLength(fileHandle);
+	if (fileSize >= 0 && fileSize < static_cast<PHYSFS_sint64>(std::numeric_limits<PHYSFS_sint32>::max()))
+	{
+		result.buffer = AsyncFileBuffer::allocate(static_cast<size_t>(fileSize));
+		result.success = WZ_PHYSFS_readBytes(fileHandle, result.buffer.data(), static_cast<PHYSFS_uint32>(fileSize)) == fileSize;
+	}
+	PHYSFS_close(fileHandle);
+	if (!result.success)
+	{
+		result.buffer = AsyncFileBuffer();
+		return result;
+	}
+
+	recordTiming(FileTiming{fileName, result.buffer.size(), microsecondsBetween(queued, start), microsecondsBetween(start, Clock::now())});
+	return result;
+}
+
+/** This runs in each I/O thread */
+static void ioThreadFunc()
+{
+	for (;;)
+	{
+		wzSemaphoreWait(ioSemaphore);  // Go to sleep until needed.
+
+		ioMutex.lock();
+		if (ioQuit)
+		{
+			ioMutex.unlock();
+			break;
+		}
+		ASSERT(!ioJobs.empty(), "Woken up without a job");
+		AsyncFileJob job = std::move(ioJobs.front());
+		ioJobs.pop_front();
+		++ioActiveJobs;
+		ioMutex.unlock();
+
+		job();
+
+		ioMutex.lock();
+		--ioActiveJobs;
+		if (waitingForIdle && ioJobs.empty() && ioActiveJobs == 0)
+		{
+			waitingForIdle = false;
+			wzSemaphorePost(idleSemaphore);
+		}
+		ioMutex.unlock();
+	}
+}
+
+static AsyncFileHandle queueJob(AsyncFileJob &&job)
+{
+	AsyncFileHandle handle = job.get_future();
+	ioMutex.lock();
+	if (ioThreads.empty())
+	{
+		ioMutex.unlock();
+		job();  // Not initialised, or shut down already.
+		return handle;
+	}
+	ioJobs.push_back(std::move(job));
+	ioMutex.unlock();
+	wzSemaphorePost(ioSemaphore);
+	return handle;
+}
+
+void asyncFileInitialise()
+{
+	if (!ioThreads.empty())
+	{
+		return;
+	}
+	// exit() would destroy ioThreads while the threads are still joinable, which calls std::terminate. Many
+	// places exit() after initialisation, such as --saveandquit and failing to start a loop, so always stop them first.
+	static bool shutdownAtExit = false;
+	if (!shutdownAtExit)
+	{
+		atexit(asyncFileShutdown);
+		shutdownAtExit = true;
+	}
+	ioQuit = false;
+	ioSemaphore = wzSemaphoreCreate(0);
+	idleSemaphore = wzSemaphoreCreate(0);
+	std::lock_guard<wz::mutex> lock(ioMutex);
+	for (unsigned n = 0; n < ASYNCFILE_THREADS; ++n)
+	{
+		ioThreads.emplace_back(ioThreadFunc);
+	}
+}
+
+void asyncFileShutdown()
+{
+	if (ioThreads.empty())
+	{
+		return;
+	}
+	asyncFileClearReadAhead();
+	asyncFileStopReadAhead();
+
+	ioMutex.lock();
+	ioQuit = true;
+	std::vector<wz::thread> threads = std::move(ioThreads);
+	ioThreads.clear();
+	ioMutex.unlock();
+	for (size_t n = 0; n < threads.size(); ++n)
+	{
+		wzSemaphorePost(ioSemaphore);  // Wake up thread.
+	}
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+	wzSemaphoreDestroy(ioSemaphore);
+	ioSemaphore = nullptr;
+	wzSemaphoreDestroy(idleSemaphore);
+	idleSemaphore = nullptr;
+
+	std::lock_guard<wz::mutex> lock(poolMutex);
+	for (auto &buffer : bufferPool)
+	{
+		free(buffer.first);
+	}
+	bufferPool.clear();
+}
+
+AsyncFileHandle asyncFileRead(const char *fileName)
+{
+	std::string name = fileName;
+	Clock::time_point queued = Clock::now();
+	return queueJob(AsyncFileJob([name, queued]() {
+		return readWholeFile(name, queued);
+	}));
+}
+
+void asyncFileReadAhead(const char *fileName)
+{
+	std::string name = fileName;
+	{
+		std::lock_guard<wz::mutex> lock(ioMutex);
+		auto i = readAheadFiles.find(name);
+		if (i != readAheadFiles.end() && i->second.generation == readAheadGeneration)
+		{
+			return;
+		}
+	}
+	Clock::time_point queued = Clock::now();
+	unsigned generation = readAheadGeneration;
+	AsyncFileHandle handle = queueJob(AsyncFileJob([name, queued, generation]() {
+		if (generation != readAheadGeneration || readAheadBytes >= ASYNCFILE_READAHEAD_MAX_SIZE)
+		{
+			return AsyncFileResult();  // Not wanted any more, or too much read ahead already.
+		}
+		AsyncFileResult result = readWholeFile(name, queued);
+		size_t size = result.buffer.size();
+		if (result.success && (readAheadBytes += size) > ASYNCFILE_READAHEAD_MAX_SIZE)
+		{
+			readAheadBytes -= size;
+			debug(LOG_WZ, "Not keeping read-ahead of %s, over the limit", name.c_str());
+			return AsyncFileResult();
+		}
+		if (result.success)
+		{
+			result.readAheadCharge = std::shared_ptr<void>(nullptr, [size](void *) { readAheadBytes -= size; });
+		}
+		return result;
+	}));
+	std::lock_guard<wz::mutex> lock(ioMutex);
+	readAheadFiles[name] = ReadAheadFile{std::move(handle), generation};
+}
+
+void asyncFileReadAheadDirectory(const char *dirName)
+{
+	std::string dir = dirName;
+	if (!dir.empty() && dir.back() != '/')
+	{
+		dir += '/';
+	}
+	char **files = PHYSFS_enumerateFiles(dir.c_str());
+	for (char **i = files; *i != nullptr; ++i)
+	{
+		std::string fileName = dir + *i;
+		if (!WZ_PHYSFS_isDirectory(fileName.c_str()))
+		{
+			asyncFileReadAhead(fileName.c_str());
+		}
+	}
+	PHYSFS_freeList(files);
+}
+
+bool asyncFileTakeReadAhead(const char *fileName, AsyncFileBuffer *buffer)
+{
+	AsyncFileHandle handle;
+	{
+		std::lock_guard<wz::mutex> lock(ioMutex);
+		auto i = readAheadFiles.find(fileName);
+		if (i == readAheadFiles.end())
+		{
+			return false;
+		}
+		handle = std::move(i->second.handle);
+		readAheadFiles.erase(i);
+	}
+
+	AsyncFileResult result = handle.get();
+	if (!result.success)
+	{
+		return false;
+	}
+	const char *realDir = PHYSFS_getRealDir(fileName);
+	if (realDir == nullptr || result.realDir != realDir)
+	{
+		debug(LOG_WZ, "Read-ahead of %s is stale, now in %s", fileName, realDir != nullptr ? realDir : "(none)");
+		return false;
+	}
+	// The file may have been overwritten since, such as a save game saved again after a failed load.
+	int64_t size, modTime;
+	if (!currentFileStamp(fileName, &size, &modTime) || size != static_cast<int64_t>(result.buffer.size()) || modTime != result.modTime)
+	{
+		debug(LOG_WZ, "Read-ahead of %s is stale, the file has changed", fileName);
+		return false;
+	}
+	*buffer = std::move(result.buffer);
+	return true;
+}
+
+void asyncFileStopReadAhead()
+{
+	++readAheadGeneration;
+
+	ioMutex.lock();
+	if (ioJobs.empty() && ioActiveJobs == 0)
+	{
+		ioMutex.unlock();
+		return;
+	}
+	waitingForIdle = true;
+	ioMutex.unlock();
+	wzSemaphoreWait(idleSemaphore);
+}
+
+void asyncFileClearReadAhead()
+{
+	++readAheadGeneration;
+
+	std::map<std::string, ReadAheadFile> files;
+	{
+		std::lock_guard<wz::mutex> lock(ioMutex);
+		std::swap(files, readAheadFiles);
+	}
+	// The handles are dropped here, outside the lock. Reads still going on free their buffers when done.
+}
+
+void asyncFileClearReadAheadDirectory(const char *dirName)
+{
+	std::string dir = dirName;
+	if (!dir.empty() && dir.back() != '/')
+	{
+		dir += '/';
+	}
+	std::vector<ReadAheadFile> files;
+	{
+		std::lock_guard<wz::mutex> lock(ioMutex);
+		for (auto i = readAheadFiles.lower_bound(dir); i != readAheadFiles.end() && i->first.compare(0, dir.size(), dir) == 0;)
+		{
+			files.push_back(std::move(i->second));
+			i = readAheadFiles.erase(i);
+		}
+	}
+	// Dropped outside the lock, as in asyncFileClearReadAhead. Reads not started yet still run, but aren't kept.
+}
+
+AsyncFileReadAheadGuard::~AsyncFileReadAheadGuard()
+{
+	if (dir.empty())
+	{
+		asyncFileClearReadAhead();
+	}
+	else
+	{
+		asyncFileClearReadAheadDirectory(dir.c_str());
+	}
+}
+
+void asyncFileRecordRead(const char *fileName, size_t size, uint64_t readMicroseconds)
+{
+	recordTiming(FileTiming{fileName, size, 0, readMicroseconds});
+}
+
+void asyncFileLogTimings(const char *what)
+{
+	std::vector<FileTiming> timings;
+	{
+		std::lock_guard<wz::mutex> lock(timingMutex);
+		std::swap(timings, fileTimings);
+	}
+	if (timings.empty())
+	{
+		return;
+	}
+
+	size_t totalSize = 0;
+	uint64_t totalRead = 0;
+	for (auto const &timing : timings)
+	{
+		totalSize += timing.size;
+		totalRead += timing.readMicroseconds;
+	}
+	debug(LOG_WZ, "%s: read %zu files, %zu bytes, in %u ms", what, timings.size(), totalSize, static_cast<unsigned>(totalRead / 1000));
+
+	const size_t slowest = std::min<size_t>(timings.size(), ASYNCFILE_LOG_SLOWEST);
+	std::partial_sort(timings.begin(), timings.begin() + slowest, timings.end(), [](FileTiming const &a, FileTiming const &b) {
+		return a.readMicroseconds > b.readMicroseconds;
+	});
+	for (size_t n = 0; n < slowest; ++n)
+	{
+		debug(LOG_WZ, "  %s: %zu bytes, read in %u us after waiting %u us", timings[n].fileName.c_str(), timings[n].size,
+		      static_cast<unsigned>(timings[n].readMicroseconds), static_cast<unsigned>(timings[n].queuedMicroseconds));
+	}
+}
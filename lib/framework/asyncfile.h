@@ -0,0 +1,121 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2005-2020  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file asyncfile.h
+ *  Reading whole files on a small pool of I/O threads.
+ *
+ *  asyncFileRead() returns a future for the file contents. asyncFileReadAhead() is a hint
+ *  that a file will soon be needed; loadFile() and friends take the contents from the
+ *  read-ahead store instead of reading the file again.
+ */
+
+#ifndef _asyncfile_h
+#define _asyncfile_h
+
+#include "wzapp.h"
+
+#include <memory>
+#include <string>
+
+/// Contents of a file, with a terminating zero. The memory goes back to a pool when released.
+class AsyncFileBuffer
+{
+public:
+	AsyncFileBuffer() = default;
+	AsyncFileBuffer(AsyncFileBuffer &&other);
+	AsyncFileBuffer(AsyncFileBuffer const &) = delete;
+	~AsyncFileBuffer();
+	AsyncFileBuffer &operator =(AsyncFileBuffer &&other);
+	AsyncFileBuffer &operator =(AsyncFileBuffer const &) = delete;
+
+	char *data() const { return pData; }
+	size_t size() const { return dataSize; }
+
+	/// Takes over the malloc()ed data, which must then be free()d by the caller.
+	char *release();
+
+	/// Gets a buffer with room for size bytes and a terminating zero, from the pool if possible.
+	static AsyncFileBuffer allocate(size_t size);
+
+private:
+	char *pData = nullptr;
+	size_t dataSize = 0;
+	size_t capacity = 0;
+};
+
+struct AsyncFileResult
+{
+	bool success = false;
+	std::string realDir;     ///< Where the file was read from, the search path may change before the result is used.
+	int64_t modTime = -1;    ///< When the file was last changed, it may be overwritten before the result is used.
+	AsyncFileBuffer buffer;
+	std::shared_ptr<void> readAheadCharge;  ///< Gives the memory back to the read-ahead limit when the result is freed.
+};
+
+typedef wz::future<AsyncFileResult> AsyncFileHandle;
+
+/** Start the I/O threads. Until this is called, files are read synchronously. */
+void asyncFileInitialise();
+
+/** Wait for the outstanding reads and stop the I/O threads. */
+void asyncFileShutdown();
+
+/** Read the whole file on an I/O thread. */
+WZ_DECL_NONNULL(1) AsyncFileHandle asyncFileRead(const char *fileName);
+
+/** Hint that the file will soon be loaded, so it can be read in the background. Files past the memory limit for read-aheads are skipped. */
+WZ_DECL_NONNULL(1) void asyncFileReadAhead(const char *fileName);
+
+/** Read ahead all files in the directory (not recursively). */
+WZ_DECL_NONNULL(1) void asyncFileReadAheadDirectory(const char *dirName);
+
+/**
+ * Take the file from the read-ahead store, waiting for it if it is still being read.
+ * Returns false if the file wasn't read ahead, couldn't be read, or the search path or file has changed since.
+ */
+WZ_DECL_NONNULL(1, 2) bool asyncFileTakeReadAhead(const char *fileName, AsyncFileBuffer *buffer);
+
+/** Skip the read-aheads not started yet, and wait for the I/O threads to go idle. Needed before unmounting anything. */
+void asyncFileStopReadAhead();
+
+/** Skip the read-aheads not started yet, and free all files read ahead but not taken. */
+void asyncFileClearReadAhead();
+
+/** Free the files in the directory read ahead but not taken. */
+WZ_DECL_NONNULL(1) void asyncFileClearReadAheadDirectory(const char *dirName);
+
+/** Clears the read-aheads of a directory, or all of them, when it goes out of scope, so that they don't outlive a load which returns early. */
+class AsyncFileReadAheadGuard
+{
+public:
+	explicit AsyncFileReadAheadGuard(std::string dirName = std::string()) : dir(std::move(dirName)) {}
+	~AsyncFileReadAheadGuard();
+	AsyncFileReadAheadGuard(AsyncFileReadAheadGuard const &) = delete;
+	AsyncFileReadAheadGuard &operator =(AsyncFileReadAheadGuard const &) = delete;
+
+private:
+	std::string dir;  ///< Empty for all read-aheads.
+};
+
+/** Record a synchronous read, so it shows up in asyncFileLogTimings() too. */
+WZ_DECL_NONNULL(1) void asyncFileRecordRead(const char *fileName, size_t size, uint64_t readMicroseconds);
+
+/** Log how long the files read since the last call took to read, and forget them. */
+WZ_DECL_NONNULL(1) void asyncFileLogTimings(const char *what);
+
+#endif // _asyncfile_h
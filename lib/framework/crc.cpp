@@ -99,6 +99,29 @@ Sha256 sha256Sum(void const *data, size_t dataLen)
 	return ret;
 }
 
+Sha256Stream::Sha256Stream()
+	: vState(new crypto_hash_sha256_state)
+{
+	crypto_hash_sha256_init((crypto_hash_sha256_state *)vState);
+}
+
+Sha256Stream::~Sha256Stream()
+{
+	delete (crypto_hash_sha256_state *)vState;
+}
+
+void Sha256Stream::update(void const *data, size_t dataLen)
+{
+	crypto_hash_sha256_update((crypto_hash_sha256_state *)vState, (const unsigned char *)data, dataLen);
+}
+
+Sha256 Sha256Stream::finalise()
+{
+	Sha256 ret;
+	crypto_hash_sha256_final((crypto_hash_sha256_state *)vState, ret.bytes);
+	return ret;
+}
+
 bool Sha256::operator ==(Sha256 const &b) const
 {
 	return memcmp(bytes, b.bytes, Bytes) == 0;
@@ -44,6 +44,22 @@ struct Sha256
 };
 Sha256 sha256Sum(void const *data, size_t dataLen);
 
+/// Incremental SHA-256, for data that isn't all in memory at once. Gives the same hash as sha256Sum on the concatenated data.
+class Sha256Stream
+{
+public:
+	Sha256Stream();
+	~Sha256Stream();
+	Sha256Stream(Sha256Stream const &) = delete;
+	Sha256Stream &operator =(Sha256Stream const &) = delete;
+
+	void update(void const *data, size_t dataLen);
+	Sha256 finalise();
+
+private:
+	void *vState;
+};
+
 class EcKey
 {
 public:
@@ -64,6 +64,8 @@ bool assertEnabled = true;
 #else
 bool assertEnabled = false;
 #endif
+// thread_local rather than WZ_DECL_THREAD, which is empty on macOS.
+static thread_local std::vector<DebugDeferredLine> *deferredLines = nullptr;
 #ifdef WZ_OS_MAC
 #include "cocoa_wrapper.h"
 #endif
@@ -448,6 +450,33 @@ const char *debugLastError()
 	}
 }
 
+void debugDeferOutput(std::vector<DebugDeferredLine> *lines)
+{
+	deferredLines = lines;
+}
+
+void debugWriteDeferred(const std::vector<DebugDeferredLine> &lines)
+{
+	for (const DebugDeferredLine &line : lines)
+	{
+		_debug(line.line, line.part, line.function.c_str(), "%s", line.text.c_str());
+		if (line.assertFailed && assertEnabled)
+		{
+			wz_assert(!line.assertFailed);
+		}
+	}
+}
+
+bool debugDeferAssert()
+{
+	if (deferredLines == nullptr || deferredLines->empty())
+	{
+		return false;
+	}
+	deferredLines->back().assertFailed = true;
+	return true;
+}
+
 void _debug(int line, code_part part, const char *function, const char *str, ...)
 {
 	va_list ap;
@@ -456,6 +485,16 @@ void _debug(int line, code_part part, const char *function, const char *str, ...
 	static unsigned int next = 2;     /* next total to print update */
 	static unsigned int prev = 0;     /* total on last update */
 
+	if (deferredLines != nullptr)
+	{
+		char deferredBuffer[MAX_LEN_LOG_LINE];
+		va_start(ap, str);
+		vssprintf(deferredBuffer, str, ap);
+		va_end(ap);
+		deferredLines->push_back(DebugDeferredLine{line, part, function, deferredBuffer, false});
+		return;
+	}
+
 	va_start(ap, str);
 	vssprintf(outputBuffer, str, ap);
 	va_end(ap);
@@ -71,7 +71,7 @@ extern bool assertEnabled;
 	  (void)_debug(__LINE__, LOG_INFO, function, __VA_ARGS__), \
 	  (void)_debug(__LINE__, LOG_INFO, function, "Assert in Warzone: %s (%s), last script event: '%s'", \
 	               location_description, expr_string, last_called_script_event), \
-	  ( assertEnabled ? (void)wz_assert(expr) : (void)0 )\
+	  ( assertEnabled && !debugDeferAssert() ? (void)wz_assert(expr) : (void)0 )\
 	)
 
 /**
@@ -269,6 +269,28 @@ void _debug(int line, code_part part, const char *function, const char *str, ...
 #endif
 
 #include <string>
+#include <vector>
+
+/** A line of debug output kept back by a thread which defers its output, see debugDeferOutput. */
+struct DebugDeferredLine
+{
+	int line;
+	code_part part;
+	std::string function;
+	std::string text;
+	bool assertFailed;  ///< The line is the last one of a failed assert, which is raised when the line is written.
+};
+
+/**
+ * Keep the debug output of the calling thread in lines, instead of writing it, until called with nullptr.
+ * For threads which run alongside the main thread: _debug() isn't thread safe, and failed asserts and
+ * fatal errors may show dialogs.
+ */
+void debugDeferOutput(std::vector<DebugDeferredLine> *lines);
+/** Write lines deferred by another thread, raising any failed asserts. Only call from the main thread. */
+void debugWriteDeferred(const std::vector<DebugDeferredLine> &lines);
+/** Used by ASSERT_FAILURE. If the calling thread defers its output, marks the assert to be raised later, and returns true. */
+bool debugDeferAssert();
 
 #define debug_multiline(part, string) do { if (enabled_debug[part]) _debug_multiline(__LINE__, part, __FUNCTION__, string); } while(0)
 void _debug_multiline(int line, code_part part, const char *function, const std::string &multilineString);
@@ -35,12 +35,38 @@ WZ_DECL_NONNULL(1) bool loadFile(const char *pFileName, char **ppFileData, UDWOR
 /** Save the data in the buffer into the given file */
 WZ_DECL_NONNULL(1) bool saveFile(const char *pFileName, const char *pFileData, UDWORD fileSize);
 
+/** A file saved with saveFile() while saving was deferred. */
+struct DeferredSaveFile
+{
+	std::string fileName;
+	std::string data;
+};
+
+/** Make saveFile() keep the files in memory instead of writing them, until saveFileEndDeferred(). Main thread only. */
+void saveFileBeginDeferred();
+
+/** Get the files saved since saveFileBeginDeferred(), in order, and make saveFile() write to disk again. */
+std::vector<DeferredSaveFile> saveFileEndDeferred();
+
+/** Write the deferred files to disk. Unlike saveFile(), this may be called from any thread. */
+bool saveDeferredFiles(std::vector<DeferredSaveFile> const &files);
+
 /** Load a file from disk into a fixed memory buffer. */
 WZ_DECL_NONNULL(1, 2) bool loadFileToBuffer(const char *pFileName, char *pFileBuffer, UDWORD bufferSize, UDWORD *pSize);
 
 /** Load a file from disk, but returns quietly if no file found. */
 WZ_DECL_NONNULL(1, 2) bool loadFileToBufferNoError(const char *pFileName, char *pFileBuffer, UDWORD bufferSize, UDWORD *pSize);
 
+/** Get the SHA-256 hash of the file, or zero on failure. Reuses earlier hashes of the file, if its size and modification time are unchanged. */
 WZ_DECL_NONNULL(1) Sha256 findHashOfFile(char const *realFileName);
 
+/** As findHashOfFile, but always reads the file, for when it may have changed without its size or modification time changing. */
+WZ_DECL_NONNULL(1) Sha256 findHashOfFileUncached(char const *realFileName);
+
+/** As findHashOfFile, but for several files, which are hashed in parallel. */
+std::vector<Sha256> findHashesOfFiles(std::vector<std::string> const &realFileNames);
+
+/** Load the file hashes cached by earlier runs from the file, and keep the file up to date from now on. */
+WZ_DECL_NONNULL(1) void initFileHashCache(char const *cacheFileName);
+
 #endif // _file_h
@@ -0,0 +1,341 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2005-2020  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file filehash.cpp
+ *  SHA-256 hashes of whole files (maps and mods), cached by size and modification time.
+ *
+ *  Files are hashed in chunks while a separate thread reads the next chunks ahead, so
+ *  big archives are never loaded into memory at once and the disk and the hash overlap.
+ */
+
+#include "frame.h"
+#include "file.h"
+#include "wzapp.h"
+#include "physfs_ext.h"
+#include <3rdparty/json/json.hpp>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <time.h>
+
+#define HASH_CHUNK_SIZE         (1024 * 1024)   ///< Size of each read when hashing a file
+#define HASH_READ_AHEAD         3               ///< Number of chunks which may be read ahead of the hash
+#define HASH_THREADS            4               ///< Maximum number of files hashed at the same time
+
+namespace
+{
+	struct FileStamp
+	{
+		std::string realDir;
+		PHYSFS_sint64 size;
+		PHYSFS_sint64 modTime;
+	};
+
+	struct CachedHash
+	{
+		PHYSFS_sint64 size;
+		PHYSFS_sint64 modTime;
+		Sha256 hash;
+	};
+}
+
+static wz::mutex fileHashMutex;
+static std::map<std::pair<std::string, std::string>, CachedHash> fileHashCache;  ///< Keyed on real directory and file name
+static std::string fileHashCacheFileName;  ///< Where the cache is stored, empty if only kept in memory
+
+/// Gets what a cached hash of the file is valid for. Returns false if the file shouldn't be cached.
+static bool getFileStamp(char const *fileName, FileStamp *stamp)
+{
+	char const *realDir = PHYSFS_getRealDir(fileName);
+	if (realDir == nullptr)
+	{
+		return false;
+	}
+	stamp->realDir = realDir;
+#if defined(WZ_PHYSFS_2_1_OR_GREATER)
+	PHYSFS_Stat metaData;
+	if (!PHYSFS_stat(fileName, &metaData) || metaData.filetype != PHYSFS_FILETYPE_REGULAR)
+	{
+		return false;
+	}
+	stamp->size = metaData.filesize;
+	stamp->modTime = metaData.modtime;
+#else
+	PHYSFS_file *fileHandle = PHYSFS_openRead(fileName);
+	if (fileHandle == nullptr)
+	{
+		return false;
+	}
+	stamp->size = PHYSFS_fileLength(fileHandle);
+	PHYSFS_close(fileHandle);
+	stamp->modTime = WZ_PHYSFS_getLastModTime(fileName);
+#endif
+	// Modification times are in seconds, so a file changed during this second could change again
+	// without its stamp changing. Only cache it once the second has passed.
+	return stamp->size >= 0 && stamp->modTime >= 0 && stamp->modTime < static_cast<PHYSFS_sint64>(time(nullptr));
+}
+
+/// Hashes the file a chunk at a time, reading the following chunks on another thread.
+static bool hashFileContents(char const *fileName, Sha256 *hash)
+{
+	PHYSFS_file *fileHandle = openLoadFile(fileName, true);
+	if (fileHandle == nullptr)
+	{
+		return false;
+	}
+
+	Sha256Stream stream;
+	bool success = true;
+	PHYSFS_sint64 fileSize = PHYSFS_fileLength(fileHandle);
+	if (fileSize >= 0 && fileSize <= HASH_CHUNK_SIZE)
+	{
+		// Not worth a thread.
+		std::vector<char> buffer(std::max<size_t>(fileSize, 1));
+		success = WZ_PHYSFS_readBytes(fileHandle, buffer.data(), fileSize) == fileSize;
+		stream.update(buffer.data(), fileSize);
+	}
+	else
+	{
+		std::vector<char> buffers[HASH_READ_AHEAD];
+		PHYSFS_sint64 lengths[HASH_READ_AHEAD];
+		WZ_SEMAPHORE *freeBuffers = wzSemaphoreCreate(HASH_READ_AHEAD);
+		WZ_SEMAPHORE *fullBuffers = wzSemaphoreCreate(0);
+		for (auto &buffer : buffers)
+		{
+			buffer.resize(HASH_CHUNK_SIZE);
+		}
+
+		// Stops after passing on a chunk of length 0 (end of file) or -1 (error).
+		wz::thread reader([&]() {
+			for (unsigned n = 0;; ++n)
+			{
+				wzSemaphoreWait(freeBuffers);
+				PHYSFS_sint64 length = WZ_PHYSFS_readBytes(fileHandle, buffers[n % HASH_READ_AHEAD].data(), HASH_CHUNK_SIZE);
+				lengths[n % HASH_READ_AHEAD] = length;
+				wzSemaphorePost(fullBuffers);
+				if (length <= 0)
+				{
+					break;
+				}
+			}
+		});
+		for (unsigned n = 0;; ++n)
+		{
+			wzSemaphoreWait(fullBuffers);
+			PHYSFS_sint64 length = lengths[n % HASH_READ_AHEAD];
+			if (length <= 0)
+			{
+				success = length == 0;
+				break;
+			}
+			stream.update(buffers[n % HASH_READ_AHEAD].data(), length);
+			wzSemaphorePost(freeBuffers);
+		}
+		reader.join();
+		wzSemaphoreDestroy(freeBuffers);
+		wzSemaphoreDestroy(fullBuffers);
+	}
+	PHYSFS_close(fileHandle);
+
+	if (!success)
+	{
+		debug(LOG_ERROR, "Failed to read %s: %s", fileName, WZ_PHYSFS_getLastError());
+		return false;
+	}
+	*hash = stream.finalise();
+	return true;
+}
+
+/// Must be called with fileHashMutex held.
+static void saveFileHashCache()
+{
+	if (fileHashCacheFileName.empty())
+	{
+		return;
+	}
+
+	// Forget files which were deleted, such as old downloaded maps. Files in directories which aren't
+	// in the search path right now are kept, they can't be checked.
+	for (auto i = fileHashCache.begin(); i != fileHashCache.end();)
+	{
+		if (PHYSFS_getMountPoint(i->first.first.c_str()) != nullptr && !PHYSFS_exists(i->first.second.c_str()))
+		{
+			debug(LOG_WZ, "Forgetting hash of %s, it no longer exists", i->first.second.c_str());
+			i = fileHashCache.erase(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	nlohmann::json root = nlohmann::json::array();
+	for (auto const &entry : fileHashCache)
+	{
+		nlohmann::json file;
+		file["dir"] = entry.first.first;
+		file["file"] = entry.first.second;
+		file["size"] = entry.second.size;
+		file["modTime"] = entry.second.modTime;
+		file["sha256"] = entry.second.hash.toString();
+		root.push_back(file);
+	}
+	std::string data = root.dump(1);
+
+	PHYSFS_file *fileHandle = PHYSFS_openWrite(fileHashCacheFileName.c_str());
+	if (fileHandle == nullptr)
+	{
+		debug(LOG_WZ, "Could not write %s: %s", fileHashCacheFileName.c_str(), WZ_PHYSFS_getLastError());
+		return;
+	}
+	if (WZ_PHYSFS_writeBytes(fileHandle, data.c_str(), data.size()) != static_cast<PHYSFS_sint64>(data.size()))
+	{
+		debug(LOG_WZ, "Could not write %s: %s", fileHashCacheFileName.c_str(), WZ_PHYSFS_getLastError());
+	}
+	PHYSFS_close(fileHandle);
+}
+
+void initFileHashCache(char const *cacheFileName)
+{
+	std::lock_guard<wz::mutex> lock(fileHashMutex);
+
+	fileHashCache.clear();
+	fileHashCacheFileName = cacheFileName;
+
+	if (!PHYSFS_exists(cacheFileName))
+	{
+		return;
+	}
+	char *data = nullptr;
+	UDWORD size = 0;
+	if (!loadFile(cacheFileName, &data, &size))
+	{
+		return;
+	}
+	try
+	{
+		nlohmann::json root = nlohmann::json::parse(data, data + size);
+		for (auto const &file : root)
+		{
+			CachedHash cached;
+			cached.size = file.at("size").get<PHYSFS_sint64>();
+			cached.modTime = file.at("modTime").get<PHYSFS_sint64>();
+			cached.hash.fromString(file.at("sha256").get<std::string>());
+			fileHashCache[{file.at("dir").get<std::string>(), file.at("file").get<std::string>()}] = cached;
+		}
+	}
+	catch (const std::exception &e)
+	{
+		debug(LOG_WARNING, "Ignoring invalid file hash cache %s: %s", cacheFileName, e.what());
+		fileHashCache.clear();
+	}
+	free(data);
+	debug(LOG_WZ, "Loaded %zu cached file hashes", fileHashCache.size());
+}
+
+/// Hashes the files, reusing the cached hashes if useCache is set, and caches the new hashes.
+static std::vector<Sha256> hashFiles(std::vector<std::string> const &realFileNames, bool useCache)
+{
+	Sha256 zero;
+	zero.setZero();
+	std::vector<Sha256> hashes(realFileNames.size(), zero);
+	std::vector<FileStamp> stamps(realFileNames.size());
+	std::vector<bool> cacheable(realFileNames.size(), false);
+	std::vector<size_t> misses;
+
+	{
+		std::lock_guard<wz::mutex> lock(fileHashMutex);
+		for (size_t n = 0; n < realFileNames.size(); ++n)
+		{
+			cacheable[n] = getFileStamp(realFileNames[n].c_str(), &stamps[n]);
+			if (cacheable[n] && useCache)
+			{
+				auto i = fileHashCache.find({stamps[n].realDir, realFileNames[n]});
+				if (i != fileHashCache.end() && i->second.size == stamps[n].size && i->second.modTime == stamps[n].modTime)
+				{
+					hashes[n] = i->second.hash;
+					continue;
+				}
+			}
+			misses.push_back(n);
+		}
+	}
+
+	if (misses.empty())
+	{
+		return hashes;
+	}
+
+	std::vector<char> hashed(realFileNames.size(), false);  // Not vector<bool>, since the threads write it concurrently.
+	auto hashMisses = [&](std::atomic<size_t> *next) {
+		for (size_t m = (*next)++; m < misses.size(); m = (*next)++)
+		{
+			size_t n = misses[m];
+			hashed[n] = hashFileContents(realFileNames[n].c_str(), &hashes[n]);
+		}
+	};
+	std::atomic<size_t> next(0);
+	if (misses.size() == 1)
+	{
+		hashMisses(&next);
+	}
+	else
+	{
+		std::vector<wz::thread> threads;
+		for (size_t t = 0; t < std::min<size_t>(misses.size(), HASH_THREADS); ++t)
+		{
+			threads.emplace_back(hashMisses, &next);
+		}
+		for (auto &thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	std::lock_guard<wz::mutex> lock(fileHashMutex);
+	bool changed = false;
+	for (size_t n : misses)
+	{
+		if (hashed[n] && cacheable[n])
+		{
+			fileHashCache[{stamps[n].realDir, realFileNames[n]}] = CachedHash{stamps[n].size, stamps[n].modTime, hashes[n]};
+			changed = true;
+		}
+	}
+	if (changed)
+	{
+		saveFileHashCache();
+	}
+	return hashes;
+}
+
+std::vector<Sha256> findHashesOfFiles(std::vector<std::string> const &realFileNames)
+{
+	return hashFiles(realFileNames, true);
+}
+
+Sha256 findHashOfFile(char const *realFileName)
+{
+	return hashFiles({realFileName}, true)[0];
+}
+
+Sha256 findHashOfFileUncached(char const *realFileName)
+{
+	return hashFiles({realFileName}, false)[0];
+}
@@ -31,9 +31,12 @@
 #include <physfs.h>
 #include "physfs_ext.h"
 
+#include "asyncfile.h"
 #include "frameresource.h"
 #include "input.h"
 
+#include <chrono>
+
 /************************************************************************************
  *
  *	Player globals
@@ -96,6 +99,9 @@ bool frameInitialise()
 		return false;
 	}
 
+	// Start the file reading threads
+	asyncFileInitialise();
+
 	return true;
 }
 
@@ -126,6 +132,8 @@ void frameShutDown()
 	// Shutdown the resource stuff
 	debug(LOG_NEVER, "No more resources!");
 	resShutDown();
+
+	asyncFileShutdown();
 }
 
 void setMouseWarp(bool value)
@@ -172,6 +180,27 @@ static bool loadFile2(const char *pFileName, char **ppFileData, UDWORD *pFileSiz
 		return false;
 	}
 
+	AsyncFileBuffer readAhead;
+	if (asyncFileTakeReadAhead(pFileName, &readAhead))
+	{
+		if (AllocateMem)
+		{
+			*pFileSize = static_cast<UDWORD>(readAhead.size());
+			*ppFileData = readAhead.release();
+			return true;
+		}
+		if (readAhead.size() > *pFileSize)
+		{
+			debug(LOG_ERROR, "No room for file %s, buffer is too small! Got: %d Need: %zu", pFileName, *pFileSize, readAhead.size());
+			assert(false);
+			return false;
+		}
+		memcpy(*ppFileData, readAhead.data(), readAhead.size() + 1);
+		*pFileSize = static_cast<UDWORD>(readAhead.size());
+		return true;
+	}
+
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
 	PHYSFS_file *pfile = openLoadFile(pFileName, hard_fail);
 	if (!pfile)
 	{
@@ -237,6 +266,7 @@ static bool loadFile2(const char *pFileName, char **ppFileData, UDWORD *pFileSiz
 	ASSERT(static_cast<PHYSFS_uint64>(filesize) <= static_cast<PHYSFS_uint64>(std::numeric_limits<UDWORD>::max()), "filesize exceeds std::numeric_limits<UDWORD>::max()");
 	*pFileSize = static_cast<UDWORD>(filesize);
 
+	asyncFileRecordRead(pFileName, *pFileSize, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count());
 	return true;
 }
 
@@ -260,6 +290,9 @@ PHYSFS_file *openSaveFile(const char *fileName)
 	return fileHandle;
 }
 
+// if not NULL, saveFile only adds the files here
+static std::vector<DeferredSaveFile> *deferredSaveFiles = nullptr;
+
 /***************************************************************************
 	Save the data in the buffer into the given file.
 ***************************************************************************/
@@ -268,6 +301,12 @@ bool saveFile(const char *pFileName, const char *pFileData, UDWORD fileSize)
 	PHYSFS_file *pfile;
 	PHYSFS_uint32 size = fileSize;
 
+	if (deferredSaveFiles != nullptr)
+	{
+		deferredSaveFiles->push_back(DeferredSaveFile{pFileName, std::string(pFileData, fileSize)});
+		return true;
+	}
+
 	debug(LOG_WZ, "We are to write (%s) of size %d", pFileName, fileSize);
 	pfile = openSaveFile(pFileName);
 	if (!pfile)
@@ -301,6 +340,45 @@ bool saveFile(const char *pFileName, const char *pFileData, UDWORD fileSize)
 	return true;
 }
 
+void saveFileBeginDeferred()
+{
+	ASSERT_OR_RETURN(, deferredSaveFiles == nullptr, "Already deferring saves");
+	deferredSaveFiles = new std::vector<DeferredSaveFile>;
+}
+
+std::vector<DeferredSaveFile> saveFileEndDeferred()
+{
+	std::vector<DeferredSaveFile> files;
+	ASSERT_OR_RETURN(files, deferredSaveFiles != nullptr, "Not deferring saves");
+	files = std::move(*deferredSaveFiles);
+	delete deferredSaveFiles;
+	deferredSaveFiles = nullptr;
+	return files;
+}
+
+bool saveDeferredFiles(std::vector<DeferredSaveFile> const &files)
+{
+	for (auto const &file : files)
+	{
+		PHYSFS_file *pfile = PHYSFS_openWrite(file.fileName.c_str());
+		if (pfile == nullptr)
+		{
+			debug(LOG_ERROR, "%s could not be opened: %s", file.fileName.c_str(), WZ_PHYSFS_getLastError());
+			return false;
+		}
+		const bool written = WZ_PHYSFS_writeBytes(pfile, file.data.data(), file.data.size()) == static_cast<PHYSFS_sint64>(file.data.size());
+		if (!written)
+		{
+			debug(LOG_ERROR, "%s could not write: %s", file.fileName.c_str(), WZ_PHYSFS_getLastError());
+		}
+		if (!PHYSFS_close(pfile) || !written)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 bool loadFile(const char *pFileName, char **ppFileData, UDWORD *pFileSize)
 {
 	return loadFile2(pFileName, ppFileData, pFileSize, true, true);
@@ -320,21 +398,6 @@ bool loadFileToBufferNoError(const char *pFileName, char *pFileBuffer, UDWORD bu
 	return loadFile2(pFileName, &pFileBuffer, pSize, false, false);
 }
 
-Sha256 findHashOfFile(char const *realFileName)
-{
-	char *realFileData = nullptr;
-	uint32_t realFileSize = 0;
-	if (loadFile(realFileName, &realFileData, &realFileSize))
-	{
-		Sha256 realFileHash = sha256Sum(realFileData, realFileSize);
-		free(realFileData);
-		return realFileHash;
-	}
-	Sha256 zero;
-	zero.setZero();
-	return zero;
-}
-
 bool PHYSFS_printf(PHYSFS_file *file, const char *format, ...)
 {
 	char vaBuffer[PATH_MAX];
@@ -29,6 +29,11 @@
 
 #include "file.h"
 #include "resly.h"
+#include "asyncfile.h"
+#include "physfs_ext.h"
+
+#include <string>
+#include <vector>
 
 // Local prototypes
 static RES_TYPE *psResTypes = nullptr;
@@ -46,6 +51,8 @@ static void ResetResourceFile();
 // callback to resload screen.
 static RESLOAD_CALLBACK resLoadCallback = nullptr;
 
+// if not NULL, resLoadFile only collects the names of the files it would read
+static std::vector<std::string> *resCollectFiles = nullptr;
 
 /* next four used in HashPJW */
 #define	BITS_IN_int		32
@@ -487,6 +494,19 @@ bool resLoadFile(const char *pType, const char *pFile)
 		return false;
 	}
 
+	if (resCollectFiles != nullptr)
+	{
+		// Only buffer loads read the file through us
+		if (psT->buffLoad != nullptr && strlen(aCurrResDir) + strlen(pFile) + 1 < PATH_MAX)
+		{
+			sstrcpy(aFileName, aCurrResDir);
+			sstrcat(aFileName, pFile);
+			makeLocaleFile(aFileName, sizeof(aFileName));
+			resCollectFiles->push_back(aFileName);
+		}
+		return true;
+	}
+
 	// Check for duplicates
 	HashedName = HashStringIgnoreCase(pFile);
 	for (psRes = psT->psRes; psRes; psRes = psRes->psNext)
@@ -857,3 +877,45 @@ void resReleaseBlockData(SDWORD blockID)
 		psNT = psT->psNext;
 	}
 }
+
+
+bool resPrefetch(const char *pResFile)
+{
+	std::vector<std::string> files;
+	char oldCurrResDir[PATH_MAX];
+	lexerinput_t input;
+	bool retval = true;
+
+	// Run the parser, without loading anything
+	input.type = LEXINPUT_PHYSFS;
+	input.input.physfsfile = PHYSFS_openRead(pResFile);
+	if (!input.input.physfsfile)
+	{
+		debug(LOG_WZ, "Not prefetching %s: %s", pResFile, WZ_PHYSFS_getLastError());
+		return false;
+	}
+	sstrcpy(oldCurrResDir, aCurrResDir);
+	sstrcpy(aCurrResDir, aResDir);
+	resCollectFiles = &files;
+	res_set_extra(&input);
+	if (res_parse() != 0)
+	{
+		debug(LOG_ERROR, "Failed to parse %s", pResFile);
+		retval = false;
+	}
+	res_lex_destroy();
+	resCollectFiles = nullptr;
+	sstrcpy(aCurrResDir, oldCurrResDir);
+	PHYSFS_close(input.input.physfsfile);
+	if (!retval)
+	{
+		return false;
+	}
+
+	debug(LOG_WZ, "Prefetching %zu files from %s", files.size(), pResFile);
+	for (const std::string &fileName : files)
+	{
+		asyncFileReadAhead(fileName.c_str());
+	}
+	return true;
+}
@@ -126,6 +126,12 @@ WZ_DECL_NONNULL(1, 3) bool resGetHashfromData(const char *pType, const void *pDa
  */
 const char *resGetNamefromData(const char *type, const void *data);
 
+/**
+ * Read ahead the files a res file would load, so a later resLoad of the res file
+ * finds them in memory instead of waiting for the disk.
+ */
+WZ_DECL_NONNULL(1) bool resPrefetch(const char *pResFile);
+
 /** Return last imd resource */
 const char *GetLastResourceFilename() WZ_DECL_PURE;
 
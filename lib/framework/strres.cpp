@@ -22,76 +22,365 @@
  *
  * String storage an manipulation functions
  *
+ * Strings are interned into large blocks and indexed by two open addressed
+ * hash tables, one keyed on the ID and one keyed on the string itself, so
+ * lookups in both directions are O(1). The entries of each loaded file can be
+ * written to a compiled string table in the write directory, which is read
+ * back on the next start instead of running the strres lexer and parser.
+ *
  */
 
 #include <string.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
 /* Allow frame header files to be singly included */
 #define FRAME_LIB_INCLUDE
 
 #include "types.h"
 #include "debug.h"
-#include "treap.h"
+#include "i18n.h"
+#include "file.h"
 #include "strres.h"
 #include "strresly.h"
 #include "physfs_ext.h"
 
+#define STRRES_BLOCK_SIZE	(16 * 1024)	///< Size of the interned string storage blocks
+#define STRRES_MIN_INDEX	256			///< Minimum number of slots in the hash indices
+
+#define STRRES_TABLE_MAGIC	"WZST"
+#define STRRES_TABLE_VERSION	1
+
+/* A string entry */
+struct STR_ENTRY
+{
+	const char     *key;            ///< The ID of the string, points into the interned storage
+	const char     *string;         ///< The string, points into the interned storage
+	uint32_t        keyHash;        ///< Hash of key
+	uint32_t        stringHash;     ///< Hash of string
+};
+
 /* A String Resource */
 struct STR_RES
 {
-	struct TREAP_NODE     **psIDTreap;              ///< The treap to store string identifiers
+	std::vector<STR_ENTRY>                  entries;        ///< All strings, in load order
+	std::vector<uint32_t>                   idIndex;        ///< Open addressed index on ID, holds entry number + 1 (0 is empty)
+	std::vector<uint32_t>                   stringIndex;    ///< Open addressed index on string, the first entry for a string wins
+	std::vector<std::unique_ptr<char[]>>    blocks;         ///< Interned string storage, never moved so pointers stay valid
+	size_t                                  blockUsed = 0;  ///< Bytes used in the last block
+	size_t                                  blockSize = 0;  ///< Size of the last block
 };
 
-/* Initialise the string system */
-STR_RES *strresCreate()
+/* Where compiled string tables are cached, empty if disabled */
+static std::string strresCacheDir;
+/* Identifies the build the compiled string tables were made with */
+static std::string strresCacheTag;
+
+/* FNV-1a, stable across platforms since it is stored in compiled string tables */
+static uint32_t strresHash(const char *str)
 {
-	STR_RES *const psRes = (STR_RES *)malloc(sizeof(*psRes));
-	if (!psRes)
+	uint32_t hash = 2166136261u;
+	for (const unsigned char *c = (const unsigned char *)str; *c != '\0'; ++c)
 	{
-		debug(LOG_FATAL, "Out of memory");
-		abort();
-		return nullptr;
+		hash = (hash ^ *c) * 16777619u;
+	}
+	return hash;
+}
+
+/* Copy a string into the interned storage */
+static const char *strresIntern(STR_RES *psRes, const char *str)
+{
+	const size_t size = strlen(str) + 1;
+	if (psRes->blocks.empty() || psRes->blockUsed + size > psRes->blockSize)
+	{
+		psRes->blockSize = std::max<size_t>(size, STRRES_BLOCK_SIZE);
+		psRes->blockUsed = 0;
+		psRes->blocks.emplace_back(new char[psRes->blockSize]);
+	}
+	char *dest = psRes->blocks.back().get() + psRes->blockUsed;
+	memcpy(dest, str, size);
+	psRes->blockUsed += size;
+	return dest;
+}
+
+/* Find the slot for a string in one of the indices, either holding it or the empty slot it belongs in */
+template <const char *STR_ENTRY::*Str>
+static uint32_t *strresFindSlot(const STR_RES *psRes, const std::vector<uint32_t> &index, const char *str, uint32_t hash)
+{
+	const uint32_t mask = index.size() - 1;
+	for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask)
+	{
+		const uint32_t entry = index[slot];
+		if (entry == 0)
+		{
+			return const_cast<uint32_t *>(&index[slot]);
+		}
+		const STR_ENTRY &psEntry = psRes->entries[entry - 1];
+		if ((Str == &STR_ENTRY::key ? psEntry.keyHash : psEntry.stringHash) == hash && strcmp(psEntry.*Str, str) == 0)
+		{
+			return const_cast<uint32_t *>(&index[slot]);
+		}
+	}
+}
+
+/* Rebuild both indices with room for at least the given number of entries */
+static void strresRehash(STR_RES *psRes, size_t count)
+{
+	size_t size = STRRES_MIN_INDEX;
+	while (size < count * 2)
+	{
+		size *= 2;
+	}
+	psRes->idIndex.assign(size, 0);
+	psRes->stringIndex.assign(size, 0);
+	for (uint32_t i = 0; i < psRes->entries.size(); ++i)
+	{
+		const STR_ENTRY &psEntry = psRes->entries[i];
+		*strresFindSlot<&STR_ENTRY::key>(psRes, psRes->idIndex, psEntry.key, psEntry.keyHash) = i + 1;
+		uint32_t *slot = strresFindSlot<&STR_ENTRY::string>(psRes, psRes->stringIndex, psEntry.string, psEntry.stringHash);
+		if (*slot == 0)
+		{
+			*slot = i + 1;
+		}
 	}
+}
 
-	psRes->psIDTreap = treapCreate();
-	if (!psRes->psIDTreap)
+/* Add an already interned entry to the table */
+static bool strresAddEntry(STR_RES *psRes, const STR_ENTRY &entry)
+{
+	// Keep the load factor at or below one half
+	if ((psRes->entries.size() + 1) * 2 > psRes->idIndex.size())
 	{
-		debug(LOG_FATAL, "Out of memory");
+		strresRehash(psRes, psRes->entries.size() + 1);
+	}
+
+	// Make sure that this ID string hasn't been used before
+	uint32_t *idSlot = strresFindSlot<&STR_ENTRY::key>(psRes, psRes->idIndex, entry.key, entry.keyHash);
+	if (*idSlot != 0)
+	{
+		debug(LOG_FATAL, "Duplicate string for id: \"%s\"", entry.key);
 		abort();
-		free(psRes);
-		return nullptr;
+		return false;
 	}
 
+	psRes->entries.push_back(entry);
+	const uint32_t entryNum = psRes->entries.size();
+	*idSlot = entryNum;
+	uint32_t *stringSlot = strresFindSlot<&STR_ENTRY::string>(psRes, psRes->stringIndex, entry.string, entry.stringHash);
+	if (*stringSlot == 0)
+	{
+		*stringSlot = entryNum;
+	}
+	return true;
+}
+
+/* Initialise the string system */
+STR_RES *strresCreate()
+{
+	STR_RES *const psRes = new STR_RES;
+	strresRehash(psRes, 0);
 	return psRes;
 }
 
 /* Shutdown the string system */
 void strresDestroy(STR_RES *psRes)
 {
-	// Release the treap and free the final memory
-	treapDestroy(psRes->psIDTreap);
-	free(psRes);
+	delete psRes;
 }
 
 
 /* Store a string */
 bool strresStoreString(STR_RES *psRes, const char *pID, const char *pString)
 {
-	// Make sure that this ID string hasn't been used before
-	if (treapFind(psRes->psIDTreap, pID) != nullptr)
+	STR_ENTRY entry;
+	entry.keyHash = strresHash(pID);
+	entry.stringHash = strresHash(pString);
+
+	// Check before interning, so a duplicate doesn't leave its copy behind
+	if (psRes->idIndex.size() > 0 && *strresFindSlot<&STR_ENTRY::key>(psRes, psRes->idIndex, pID, entry.keyHash) != 0)
 	{
 		debug(LOG_FATAL, "Duplicate string for id: \"%s\"", pID);
 		abort();
 		return false;
 	}
 
-	return treapAdd(psRes->psIDTreap, pID, pString);
+	entry.key = strresIntern(psRes, pID);
+	entry.string = strresIntern(psRes, pString);
+	return strresAddEntry(psRes, entry);
 }
 
 const char *strresGetString(const STR_RES *psRes, const char *ID)
 {
-	return treapFind(psRes->psIDTreap, ID);
+	const uint32_t entry = *strresFindSlot<&STR_ENTRY::key>(psRes, psRes->idIndex, ID, strresHash(ID));
+	return entry != 0 ? psRes->entries[entry - 1].string : nullptr;
+}
+
+void strresSetCacheDir(const char *dir, const char *buildTag)
+{
+	strresCacheDir = dir != nullptr ? dir : "";
+	strresCacheTag = buildTag != nullptr ? buildTag : "";
+}
+
+static void strresWriteUint32(std::vector<char> &buffer, uint32_t value)
+{
+	const char bytes[4] = {(char)(value & 0xFF), (char)((value >> 8) & 0xFF), (char)((value >> 16) & 0xFF), (char)((value >> 24) & 0xFF)};
+	buffer.insert(buffer.end(), bytes, bytes + 4);
+}
+
+static uint32_t strresReadUint32(const char *data)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/**
+ * Load a compiled string table written by strresSaveTable.
+ *
+ * The whole string pool is copied into a single block in one go and the stored
+ * hashes are reused, so nothing is lexed, parsed or rehashed.
+ */
+static bool strresLoadTable(STR_RES *psRes, const char *tableName, const std::string &tag)
+{
+	if (!PHYSFS_exists(tableName))
+	{
+		return false;
+	}
+
+	char *data = nullptr;
+	UDWORD size = 0;
+	if (!loadFile(tableName, &data, &size))
+	{
+		return false;
+	}
+
+	const size_t headerSize = 4 + 4 + 4 + tag.size() + 4 + 4;
+	const char *pos = data;
+	const char *const end = data + size;
+	bool valid = size >= headerSize
+	             && memcmp(pos, STRRES_TABLE_MAGIC, 4) == 0
+	             && strresReadUint32(pos + 4) == STRRES_TABLE_VERSION
+	             && strresReadUint32(pos + 8) == tag.size()
+	             && memcmp(pos + 12, tag.data(), tag.size()) == 0;
+	uint32_t count = 0, poolSize = 0;
+	if (valid)
+	{
+		pos += 12 + tag.size();
+		count = strresReadUint32(pos);
+		poolSize = strresReadUint32(pos + 4);
+		pos += 8;
+		valid = (size_t)(end - pos) == (size_t)count * 16 + poolSize && (poolSize == 0 || end[-1] == '\0');
+	}
+	if (!valid)
+	{
+		debug(LOG_WZ, "Ignoring stale compiled string table %s", tableName);
+		free(data);
+		return false;
+	}
+
+	// Check every record before adding any, so that a corrupt table leaves nothing behind
+	const char *const entryData = pos;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const char *record = entryData + i * 16;
+		if (strresReadUint32(record) >= poolSize || strresReadUint32(record + 4) >= poolSize)
+		{
+			debug(LOG_ERROR, "Corrupt compiled string table %s", tableName);
+			free(data);
+			return false;
+		}
+	}
+
+	const size_t oldEntries = psRes->entries.size();
+	const size_t oldBlocks = psRes->blocks.size();
+	const size_t oldBlockUsed = psRes->blockUsed, oldBlockSize = psRes->blockSize;
+	char *pool = nullptr;
+	if (poolSize > 0)
+	{
+		psRes->blocks.emplace_back(new char[poolSize]);
+		pool = psRes->blocks.back().get();
+		memcpy(pool, entryData + count * 16, poolSize);
+		// Later strings go into a fresh block
+		psRes->blockUsed = psRes->blockSize = poolSize;
+	}
+
+	if ((psRes->entries.size() + count) * 2 > psRes->idIndex.size())
+	{
+		strresRehash(psRes, psRes->entries.size() + count);
+	}
+	psRes->entries.reserve(psRes->entries.size() + count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const char *record = entryData + i * 16;
+		STR_ENTRY entry;
+		entry.key = pool + strresReadUint32(record);
+		entry.string = pool + strresReadUint32(record + 4);
+		entry.keyHash = strresReadUint32(record + 8);
+		entry.stringHash = strresReadUint32(record + 12);
+		// A duplicate id would be fatal in strresAddEntry, but here it only means the table is corrupt
+		if (*strresFindSlot<&STR_ENTRY::key>(psRes, psRes->idIndex, entry.key, entry.keyHash) != 0 || !strresAddEntry(psRes, entry))
+		{
+			debug(LOG_ERROR, "Corrupt compiled string table %s", tableName);
+			psRes->entries.resize(oldEntries);
+			psRes->blocks.resize(oldBlocks);
+			psRes->blockUsed = oldBlockUsed;
+			psRes->blockSize = oldBlockSize;
+			strresRehash(psRes, oldEntries);
+			free(data);
+			return false;
+		}
+	}
+
+	free(data);
+	debug(LOG_WZ, "Loaded %u strings from compiled string table %s", count, tableName);
+	return true;
+}
+
+/* Write the entries from firstEntry onwards into a compiled string table */
+static bool strresSaveTable(const STR_RES *psRes, size_t firstEntry, const char *tableName, const std::string &tag)
+{
+	const uint32_t count = psRes->entries.size() - firstEntry;
+	std::vector<char> pool;
+	std::vector<char> buffer;
+	buffer.insert(buffer.end(), STRRES_TABLE_MAGIC, STRRES_TABLE_MAGIC + 4);
+	strresWriteUint32(buffer, STRRES_TABLE_VERSION);
+	strresWriteUint32(buffer, tag.size());
+	buffer.insert(buffer.end(), tag.begin(), tag.end());
+	strresWriteUint32(buffer, count);
+	const size_t poolSizePos = buffer.size();
+	strresWriteUint32(buffer, 0);
+	for (size_t i = firstEntry; i < psRes->entries.size(); ++i)
+	{
+		const STR_ENTRY &psEntry = psRes->entries[i];
+		strresWriteUint32(buffer, pool.size());
+		pool.insert(pool.end(), psEntry.key, psEntry.key + strlen(psEntry.key) + 1);
+		strresWriteUint32(buffer, pool.size());
+		pool.insert(pool.end(), psEntry.string, psEntry.string + strlen(psEntry.string) + 1);
+		strresWriteUint32(buffer, psEntry.keyHash);
+		strresWriteUint32(buffer, psEntry.stringHash);
+	}
+	std::vector<char> poolSize;
+	strresWriteUint32(poolSize, pool.size());
+	std::copy(poolSize.begin(), poolSize.end(), buffer.begin() + poolSizePos);
+	buffer.insert(buffer.end(), pool.begin(), pool.end());
+
+	PHYSFS_file *fileHandle = PHYSFS_openWrite(tableName);
+	if (fileHandle == nullptr)
+	{
+		debug(LOG_WZ, "Could not write compiled string table %s: %s", tableName, WZ_PHYSFS_getLastError());
+		return false;
+	}
+	const bool success = WZ_PHYSFS_writeBytes(fileHandle, buffer.data(), buffer.size()) == (PHYSFS_sint64)buffer.size();
+	PHYSFS_close(fileHandle);
+	if (!success)
+	{
+		debug(LOG_WZ, "Could not write compiled string table %s: %s", tableName, WZ_PHYSFS_getLastError());
+		PHYSFS_delete(tableName);
+	}
+	return success;
 }
 
 /* Load a string resource file */
@@ -109,17 +398,48 @@ bool strresLoad(STR_RES *psRes, const char *fileName)
 		return false;
 	}
 
+	// The compiled table is only valid for the same source file, language and build
+	std::string tableName, tag;
+	if (!strresCacheDir.empty())
+	{
+		tableName = fileName;
+		for (char &c : tableName)
+		{
+			if (c == '/' || c == '\\' || c == ':')
+			{
+				c = '_';
+			}
+		}
+		tableName = strresCacheDir + "/" + tableName + ".bin";
+		const char *realDir = PHYSFS_getRealDir(fileName);
+		tag = strresCacheTag + "\n" + getLanguage() + "\n" + (realDir ? realDir : "") + "\n"
+		      + std::to_string(PHYSFS_fileLength(input.input.physfsfile)) + "\n"
+		      + std::to_string(WZ_PHYSFS_getLastModTime(fileName));
+		if (strresLoadTable(psRes, tableName.c_str(), tag))
+		{
+			PHYSFS_close(input.input.physfsfile);
+			return true;
+		}
+	}
+	const size_t firstEntry = psRes->entries.size();
+
 	strres_set_extra(&input);
 	retval = (strres_parse(psRes) == 0);
 
 	strres_lex_destroy();
 	PHYSFS_close(input.input.physfsfile);
 
+	if (retval && !tableName.empty())
+	{
+		strresSaveTable(psRes, firstEntry, tableName.c_str(), tag);
+	}
+
 	return retval;
 }
 
 /* Get the ID number for a string*/
 const char *strresGetIDfromString(STR_RES *psRes, const char *pString)
 {
-	return treapFindKey(psRes->psIDTreap, pString);
+	const uint32_t entry = *strresFindSlot<&STR_ENTRY::string>(psRes, psRes->stringIndex, pString, strresHash(pString));
+	return entry != 0 ? psRes->entries[entry - 1].key : nullptr;
 }
@@ -48,4 +48,12 @@ WZ_DECL_NONNULL(1, 2) bool strresLoad(struct STR_RES *psRes, const char *fileNam
 /* Get the ID string for a string */
 WZ_DECL_NONNULL(1, 2) const char *strresGetIDfromString(struct STR_RES *psRes, const char *pString);
 
+/**
+ * Cache compiled string tables, so that later strresLoad calls can skip parsing.
+ *
+ * @param dir directory in the PhysFS write dir to store compiled tables in, or NULL to disable caching
+ * @param buildTag identifies the build (and thus the translations) the tables are compiled with
+ */
+void strresSetCacheDir(const char *dir, const char *buildTag);
+
 #endif
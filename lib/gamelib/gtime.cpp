@@ -31,6 +31,8 @@
 #include "gtime.h"
 #include "src/multiplay.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netlog.h"
+#include "lib/netplay/netreplay.h"
 
 
 #include <time.h>
@@ -64,6 +66,18 @@ static uint16_t discreteChosenLatency = GAME_TICKS_PER_UPDATE;
 static uint16_t wantedLatency = GAME_TICKS_PER_UPDATE;
 static uint16_t wantedLatencies[MAX_PLAYERS];
 
+/// How much latency each player needs, so that we don't have to wait for their GAME_GAME_TIME messages. Smoothed like TCP round trip times.
+struct PlayerLatency
+{
+	uint32_t readyTime;  ///< wzGetTicks() when we had the player's GAME_GAME_TIME for the next update, 0 if we don't yet.
+	int      mean;       ///< Smoothed needed latency, in milliseconds.
+	int      deviation;  ///< Smoothed mean deviation of the needed latency, in milliseconds.
+	bool     valid;      ///< Whether mean and deviation have been set yet.
+};
+static PlayerLatency playerLatencies[MAX_PLAYERS];
+static const int latencyJitterMargin = 2;  ///< Number of mean deviations to add to the latency, to avoid waiting on jittery connections.
+static const int latencyBuffer = 10;       ///< Milliseconds to add to the latency, just in case.
+
 static void updateLatency(void);
 
 static std::string listToString(char const *format, char const *separator, uint32_t const *begin, uint32_t const *end)
@@ -110,6 +124,7 @@ void gameTimeInit(void)
 	for (player = 0; player != MAX_PLAYERS; ++player)
 	{
 		wantedLatencies[player] = 0;
+		playerLatencies[player] = PlayerLatency {0, 0, 0, false};
 	}
 
 	// Don't let syncDebug from previous games cause a desynch dump at gameTime 102.
@@ -322,37 +337,86 @@ void getTimeComponents(unsigned time, int *hours, int *minutes, int *seconds, in
 	*hours = time;
 }
 
+static std::string playerLatenciesToString()
+{
+	std::string ret;
+	for (unsigned player = 0; player < game.maxPlayers; ++player)
+	{
+		if (playerLatencies[player].valid && NetPlay.players[player].allocated)
+		{
+			char tmp[100];
+			ssprintf(tmp, "%sp%u: %d+-%d", ret.empty() ? "" : ", ", player, playerLatencies[player].mean, playerLatencies[player].deviation);
+			ret += tmp;
+		}
+	}
+	return ret;
+}
+
 static void updateLatency()
 {
 	uint16_t maxWantedLatency = 0;
+	unsigned maxWantedPlayer = 0;
 	unsigned player;
 	uint16_t prevDiscreteChosenLatency = discreteChosenLatency;
+	uint32_t now = wzGetTicks();
 
 	// Find out what latency has been agreed on, next.
 	for (player = 0; player < game.maxPlayers; ++player)
 	{
-		if (NetPlay.players[player].allocated)  // Don't wait for dropped/kicked players.
+		if (NetPlay.players[player].allocated && wantedLatencies[player] > maxWantedLatency)  // Don't wait for dropped/kicked players.
 		{
 			//minWantedLatency = MIN(minWantedLatency, wantedLatencies[player]);  // Minimum, so the clients don't increase the latency to try to make one slow computer run faster.
-			maxWantedLatency = MAX(maxWantedLatency, wantedLatencies[player]);  // Maximum, since the host experiences lower latency than everyone else.
+			maxWantedLatency = wantedLatencies[player];  // Maximum, since the host experiences lower latency than everyone else.
+			maxWantedPlayer = player;
 		}
 	}
-	// Adjust the agreed latency. (Can maximum decrease by 5ms or increase by 30ms per update.
+	// Adjust the agreed latency. (Can maximum decrease by 5ms or increase by 60ms per update.)
 	chosenLatency = chosenLatency + clip(maxWantedLatency - chosenLatency, -5, 60);
-	// Round the chosen latency to an integer number of updates, up to 10.
-	discreteChosenLatency = clip((chosenLatency + GAME_TICKS_PER_UPDATE / 2) / GAME_TICKS_PER_UPDATE * GAME_TICKS_PER_UPDATE, GAME_TICKS_PER_UPDATE, GAME_TICKS_PER_UPDATE * GAME_UPDATES_PER_SEC);
+	// Round the chosen latency to an integer number of updates, up to 10. Only change it when the chosen latency is well past halfway to another
+	// number of updates, so it doesn't flip back and forth while the chosen latency hovers around halfway.
+	// All clients choose the same latency, since they all get the same GAME_GAME_TIME messages.
+	if (abs(chosenLatency - discreteChosenLatency) > GAME_TICKS_PER_UPDATE * 6 / 10)
+	{
+		discreteChosenLatency = clip((chosenLatency + GAME_TICKS_PER_UPDATE / 2) / GAME_TICKS_PER_UPDATE * GAME_TICKS_PER_UPDATE, GAME_TICKS_PER_UPDATE, GAME_TICKS_PER_UPDATE * GAME_UPDATES_PER_SEC);
+	}
 	if (prevDiscreteChosenLatency != discreteChosenLatency)
 	{
-		debug(LOG_SYNC, "Adjusting latency %d -> %d", prevDiscreteChosenLatency, discreteChosenLatency);
+		debug(LOG_SYNC, "Adjusting latency %d -> %d, since player %u wants %u. Latencies we need: {%s}", prevDiscreteChosenLatency, discreteChosenLatency, maxWantedPlayer, maxWantedLatency, playerLatenciesToString().c_str());
 	}
 
-	// We want the chosen latency to increase by how much our update was delayed waiting for others, or to decrease by how long after we got the messages from others that it was time to tick. Plus a tiny 10ms buffer.
-	// We will send this number to others.
-	wantedLatency = clip((int)(discreteChosenLatency + updateReadyTime - updateWantedTime + 10), 0, UINT16_MAX);
+	// For each player, we would have needed the chosen latency plus how much our update was delayed waiting for them, or minus how long before it was
+	// time to tick we got their messages. Track the mean and deviation of that, rising quickly and falling slowly, and want enough latency to cover
+	// the jitter of the worst connection, plus a tiny buffer. We will send this number to others.
+	int maxNeededLatency = 0;
+	for (player = 0; player < game.maxPlayers; ++player)
+	{
+		PlayerLatency &latency = playerLatencies[player];
+		if (!NetPlay.players[player].allocated || latency.readyTime == 0)
+		{
+			continue;
+		}
+		int sample = std::max((int)(discreteChosenLatency + latency.readyTime - updateWantedTime), 0);
+		if (!latency.valid)
+		{
+			latency.mean = sample;
+			latency.deviation = 0;
+			latency.valid = true;
+		}
+		latency.deviation += (abs(sample - latency.mean) - latency.deviation) / 4;
+		latency.mean += sample > latency.mean ? (sample - latency.mean + 1) / 2 : (sample - latency.mean) / 8;
+		maxNeededLatency = std::max(maxNeededLatency, latency.mean + latencyJitterMargin * latency.deviation);
+	}
+	wantedLatency = clip(maxNeededLatency + latencyBuffer, 0, UINT16_MAX);
+	NETlogHistogram(NetHistogramLatency, wantedLatency);
+	NETlogHistogram(NetHistogramUpdateWait, std::max((int)(updateReadyTime - updateWantedTime), 0));
 
-	// Reset the times, ready to be set again.
+	// Reset the times, ready to be set again. Players whose messages for the next update we already have, were ready now.
 	updateReadyTime = 0;
 	updateWantedTime = 0;
+	for (player = 0; player < game.maxPlayers; ++player)
+	{
+		playerLatencies[player].readyTime = checkPlayerGameTime(player) ? now : 0;
+	}
 }
 
 void sendPlayerGameTime()
@@ -404,8 +468,16 @@ void recvPlayerGameTime(NETQUEUE queue)
 		{
 			NETsetPlayerConnectionStatus(CONNECTIONSTATUS_DESYNC, queue.index);
 		}
+		if (NETisReplay())
+		{
+			NETreplayDesynch(checkTime, queue.index);
+		}
 	}
 
+	if (playerLatencies[queue.index].readyTime == 0 && checkPlayerGameTime(queue.index))
+	{
+		playerLatencies[queue.index].readyTime = wzGetTicks();  // This is the time this player allowed us to tick.
+	}
 	if (updateReadyTime == 0 && checkPlayerGameTime(NET_ALL_PLAYERS))
 	{
 		updateReadyTime = wzGetTicks();  // This is the time we were able to tick.
@@ -28,31 +28,51 @@
 #include "netlog.h"
 #include "netplay.h"
 
+#include <3rdparty/json/json.hpp>
+using json = nlohmann::json;
+
 // ////////////////////////////////////////////////////////////////////////
 // Logging for debug only
 // ////////////////////////////////////////////////////////////////////////
 
 #define NUM_GAME_PACKETS 256
+#define NUM_HISTOGRAM_BUCKETS 18  // Bucket 0 is 0ms, bucket n is [2^(n-1), 2^n) ms, and the last one is everything longer.
 
 static PHYSFS_file	*pFileHandle = nullptr;
 static uint32_t		packetcount[2][NUM_GAME_PACKETS];
 static uint32_t		packetsize[2][NUM_GAME_PACKETS];
+static uint64_t		packetmicroseconds[2][NUM_GAME_PACKETS];
+static uint32_t		packetqueuedcount[NUM_GAME_PACKETS];
+static uint64_t		packetqueuedtotal[NUM_GAME_PACKETS];
+static uint32_t		packetqueuedmax[NUM_GAME_PACKETS];
+static uint32_t		histograms[NetHistogramMax][NUM_HISTOGRAM_BUCKETS];
+static const char	*histogramNames[NetHistogramMax] = {"latency", "updateWait"};
 
-bool NETstartLogging(void)
+void NETresetStatistics()
 {
-	time_t aclock;
-	struct tm *newtime;
-	char buf[256];
-	static char filename[256] = {'\0'};
-	int i;
-
-	for (i = 0; i < NUM_GAME_PACKETS; i++)
+	for (int i = 0; i < NUM_GAME_PACKETS; i++)
 	{
 		packetcount[0][i] = 0;
 		packetsize[0][i] = 0;
+		packetmicroseconds[0][i] = 0;
 		packetcount[1][i] = 0;
 		packetsize[1][i] = 0;
+		packetmicroseconds[1][i] = 0;
+		packetqueuedcount[i] = 0;
+		packetqueuedtotal[i] = 0;
+		packetqueuedmax[i] = 0;
 	}
+	memset(histograms, 0, sizeof(histograms));
+}
+
+bool NETstartLogging(void)
+{
+	time_t aclock;
+	struct tm *newtime;
+	char buf[256];
+	static char filename[256] = {'\0'};
+
+	NETresetStatistics();
 
 	time(&aclock);                   /* Get time in seconds */
 	newtime = localtime(&aclock);    /* Convert time to struct */
@@ -91,8 +111,8 @@ bool NETstopLogging(void)
 		}
 		else
 		{
-			snprintf(buf, sizeof(buf), "%-24s:\t received %u times, %u bytes; sent %u times, %u bytes\n", messageTypeToString(i),
-			         packetcount[1][i], packetsize[1][i], packetcount[0][i], packetsize[0][i]);
+			snprintf(buf, sizeof(buf), "%-24s:\t received %u times, %u bytes, decoded in %llu us; sent %u times, %u bytes, encoded in %llu us\n", messageTypeToString(i),
+			         packetcount[1][i], packetsize[1][i], (unsigned long long)packetmicroseconds[1][i], packetcount[0][i], packetsize[0][i], (unsigned long long)packetmicroseconds[0][i]);
 		}
 		WZ_PHYSFS_writeBytes(pFileHandle, buf, strlen(buf));
 		totalBytessent += packetsize[0][i];
@@ -150,6 +170,111 @@ void NETlogPacket(uint8_t type, uint32_t size, bool received)
 	packetsize[received][type] += size;
 }
 
+void NETlogPacketTime(uint8_t type, uint32_t microseconds, bool received)
+{
+	packetmicroseconds[received][type] += microseconds;
+}
+
+void NETlogPacketQueued(uint8_t type, uint32_t milliseconds)
+{
+	packetqueuedcount[type]++;
+	packetqueuedtotal[type] += milliseconds;
+	packetqueuedmax[type] = std::max(packetqueuedmax[type], milliseconds);
+}
+
+void NETlogHistogram(NetHistogram histogram, uint32_t milliseconds)
+{
+	unsigned bucket = 0;
+	while (milliseconds != 0 && bucket < NUM_HISTOGRAM_BUCKETS - 1)
+	{
+		milliseconds >>= 1;
+		++bucket;
+	}
+	histograms[histogram][bucket]++;
+}
+
+NetPacketStatistics NETgetPacketStatistics(uint8_t type)
+{
+	NetPacketStatistics stats;
+	for (int received = 0; received < 2; ++received)
+	{
+		stats.count[received] = packetcount[received][type];
+		stats.bytes[received] = packetsize[received][type];
+		stats.microseconds[received] = packetmicroseconds[received][type];
+	}
+	stats.queuedCount = packetqueuedcount[type];
+	stats.queuedMilliseconds = packetqueuedtotal[type];
+	stats.queuedMaxMilliseconds = packetqueuedmax[type];
+	return stats;
+}
+
+static uint32_t histogramBucketEnd(unsigned bucket)
+{
+	return bucket < NUM_HISTOGRAM_BUCKETS - 1 ? 1u << bucket : UINT32_MAX;
+}
+
+uint32_t NETgetHistogramPercentile(NetHistogram histogram, unsigned percent)
+{
+	uint64_t total = 0;
+	for (unsigned bucket = 0; bucket < NUM_HISTOGRAM_BUCKETS; ++bucket)
+	{
+		total += histograms[histogram][bucket];
+	}
+	uint64_t wanted = (total * percent + 99) / 100;
+	uint64_t sum = 0;
+	for (unsigned bucket = 0; bucket < NUM_HISTOGRAM_BUCKETS; ++bucket)
+	{
+		sum += histograms[histogram][bucket];
+		if (sum >= wanted && sum != 0)
+		{
+			return histogramBucketEnd(bucket);
+		}
+	}
+	return 0;
+}
+
+bool NETdumpStatistics(const char *fileName)
+{
+	json messages = json::object();
+	for (int i = 0; i < NUM_GAME_PACKETS; i++)
+	{
+		if (packetcount[0][i] == 0 && packetcount[1][i] == 0 && packetqueuedcount[i] == 0)
+		{
+			continue;
+		}
+		json sent = {{"count", packetcount[0][i]}, {"bytes", packetsize[0][i]}, {"encodeMicroseconds", packetmicroseconds[0][i]}};
+		json received = {{"count", packetcount[1][i]}, {"bytes", packetsize[1][i]}, {"decodeMicroseconds", packetmicroseconds[1][i]}};
+		json queued = {{"count", packetqueuedcount[i]}, {"totalMilliseconds", packetqueuedtotal[i]}, {"maxMilliseconds", packetqueuedmax[i]}};
+		messages[messageTypeToString(i)] = {{"sent", sent}, {"received", received}, {"queued", queued}};
+	}
+
+	json buckets = json::array();
+	for (unsigned bucket = 0; bucket < NUM_HISTOGRAM_BUCKETS - 1; ++bucket)
+	{
+		buckets.push_back(histogramBucketEnd(bucket));
+	}
+	json histogramsJson = {{"bucketEndMilliseconds", buckets}};
+	for (int histogram = 0; histogram < NetHistogramMax; ++histogram)
+	{
+		histogramsJson[histogramNames[histogram]] = std::vector<uint32_t>(histograms[histogram], histograms[histogram] + NUM_HISTOGRAM_BUCKETS);
+	}
+
+	std::string data = json({{"messages", messages}, {"histograms", histogramsJson}}).dump(1, '\t');
+	PHYSFS_file *fileHandle = PHYSFS_openWrite(fileName);
+	if (fileHandle == nullptr)
+	{
+		debug(LOG_ERROR, "Could not create %s: %s", fileName, WZ_PHYSFS_getLastError());
+		return false;
+	}
+	bool written = WZ_PHYSFS_writeBytes(fileHandle, data.data(), data.size()) == static_cast<PHYSFS_sint64>(data.size());
+	if (!PHYSFS_close(fileHandle) || !written)
+	{
+		debug(LOG_ERROR, "Could not write %s: %s", fileName, WZ_PHYSFS_getLastError());
+		return false;
+	}
+	return true;
+}
+
 bool NETlogEntry(const char *str, UDWORD a, UDWORD b)
 {
 	static const char star_line[] = "************************************************************\n";
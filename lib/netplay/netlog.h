@@ -24,9 +24,33 @@
 
 #include "netplay.h"
 
+enum NetHistogram
+{
+	NetHistogramLatency,    ///< Latency we want, in milliseconds, so we don't have to wait for the GAME_GAME_TIME messages of the other players. Once per game update.
+	NetHistogramUpdateWait, ///< Milliseconds a game update was delayed, waiting for the GAME_GAME_TIME messages of the other players. Once per game update.
+	NetHistogramMax
+};
+
+struct NetPacketStatistics
+{
+	uint32_t count[2];                  ///< Number of messages sent and received, indexed by received.
+	uint32_t bytes[2];                  ///< Size of the messages sent and received.
+	uint64_t microseconds[2];           ///< Time spent encoding the messages sent, and decoding the messages received.
+	uint32_t queuedCount;               ///< Number of messages popped from the queues.
+	uint64_t queuedMilliseconds;        ///< Total time the popped messages were queued, before being processed.
+	uint32_t queuedMaxMilliseconds;     ///< Longest time a popped message was queued.
+};
+
 bool NETstartLogging();
+void NETresetStatistics();  ///< Clears the message statistics and histograms, so they only cover what follows, such as one game.
 bool NETstopLogging();
 WZ_DECL_NONNULL(1) bool NETlogEntry(const char *str, UDWORD a, UDWORD b);
 void NETlogPacket(uint8_t type, uint32_t size, bool received);
+void NETlogPacketTime(uint8_t type, uint32_t microseconds, bool received);  ///< Time spent encoding or decoding a message.
+void NETlogPacketQueued(uint8_t type, uint32_t milliseconds);                ///< Time a message was queued, before being popped.
+void NETlogHistogram(NetHistogram histogram, uint32_t milliseconds);
+NetPacketStatistics NETgetPacketStatistics(uint8_t type);
+uint32_t NETgetHistogramPercentile(NetHistogram histogram, unsigned percent);  ///< Returns an upper bound in milliseconds, or 0 if nothing was logged yet.
+WZ_DECL_NONNULL(1) bool NETdumpStatistics(const char *fileName);              ///< Writes the message statistics and histograms as JSON.
 
 #endif // _netlog_h
@@ -41,9 +41,11 @@
 #include <memory>
 #include <thread>
 #include <atomic>
+#include <deque>
 
 #include "netplay.h"
 #include "netlog.h"
+#include "netreplay.h"
 #include "netsocket.h"
 
 #include <miniupnpc/miniwget.h>
@@ -109,8 +111,8 @@ std::atomic_int upnp_status;
 
 struct Statistic
 {
-	unsigned sent;
-	unsigned received;
+	uint64_t sent;
+	uint64_t received;
 };
 
 struct NETSTATS  // data regarding the last one second or so.
@@ -118,6 +120,7 @@ struct NETSTATS  // data regarding the last one second or so.
 	Statistic       rawBytes;               // Number of actual bytes, in about 1 sec.
 	Statistic       uncompressedBytes;      // Number of bytes sent, before compression, in about 1 sec.
 	Statistic       packets;                // Number of calls to writeAll, in about 1 sec.
+	Statistic       compressionMicroseconds;  // Time spent compressing and decompressing, in about 1 sec.
 };
 
 struct NET_PLAYER_DATA
@@ -166,12 +169,22 @@ static Socket *tmp_socket[MAX_TMP_SOCKETS] = { nullptr };  ///< Sockets used to
 
 static SocketSet *tmp_socket_set = nullptr;
 static int32_t          NetGameFlags[4] = { 0, 0, 0, 0 };
+
+/// Data received from a player, held back to simulate a slow or jittery connection.
+struct DelayedNetData
+{
+	uint32_t releaseTime;
+	std::vector<uint8_t> data;
+};
+static std::deque<DelayedNetData> delayedNetData[MAX_CONNECTED_PLAYERS];
+static unsigned simulatedNetDelay = 0;   ///< Milliseconds to hold back received data, for testing.
+static unsigned simulatedNetJitter = 0;  ///< Up to this many extra milliseconds, chosen randomly for each read.
 char iptoconnect[PATH_MAX] = "\0"; // holds IP/hostname from command line
 
-static NETSTATS nStats              = {{0, 0}, {0, 0}, {0, 0}};
-static NETSTATS nStatsLastSec       = {{0, 0}, {0, 0}, {0, 0}};
-static NETSTATS nStatsSecondLastSec = {{0, 0}, {0, 0}, {0, 0}};
-static const NETSTATS nZeroStats    = {{0, 0}, {0, 0}, {0, 0}};
+static NETSTATS nStats              = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
+static NETSTATS nStatsLastSec       = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
+static NETSTATS nStatsSecondLastSec = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
+static const NETSTATS nZeroStats    = {{0, 0}, {0, 0}, {0, 0}, {0, 0}};
 static int nStatsLastUpdateTime = 0;
 
 unsigned NET_PlayerConnectionStatus[CONNECTIONSTATUS_NORMAL][MAX_PLAYERS];
@@ -184,7 +197,7 @@ unsigned NET_PlayerConnectionStatus[CONNECTIONSTATUS_NORMAL][MAX_PLAYERS];
 **/
 static char const *versionString = version_getVersionString();
 static int NETCODE_VERSION_MAJOR = 0x1000;
-static int NETCODE_VERSION_MINOR = 1;
+static int NETCODE_VERSION_MINOR = 4;  // 2: NET_FILE_REQUESTED has a resume position, and file chunks are acked. 3: GAME_DROIDINFO batched orders, since undone. 4: The agreed latency only changes more than 60% of an update away.
 
 bool NETisCorrectVersion(uint32_t game_version_major, uint32_t game_version_minor)
 {
@@ -526,6 +539,10 @@ static void NET_DestroyPlayer(unsigned int index, bool suppressActivityUpdates =
 		}
 	}
 	NET_InitPlayer(index, false);  // reinitialize
+	if (index < MAX_CONNECTED_PLAYERS)
+	{
+		delayedNetData[index].clear();
+	}
 	if (wasAllocated && !suppressActivityUpdates)
 	{
 		ActivityManager::instance().updateMultiplayGameData(game, ingame, NETGameIsLocked());
@@ -1171,6 +1188,12 @@ int NETinit(bool bFirstCall)
 
 	SOCKETinit();
 
+	// Reset net usage statistics. SOCKETinit keeps the totals of a running socket thread.
+	socketResetCompressionStats();
+	nStats = nZeroStats;
+	nStatsLastSec = nZeroStats;
+	nStatsSecondLastSec = nZeroStats;
+
 	if (bFirstCall)
 	{
 		debug(LOG_NET, "NETPLAY: Init called, MORNIN'");
@@ -1311,18 +1334,49 @@ int NETclose()
 
 // ////////////////////////////////////////////////////////////////////////
 // return bytes of data sent recently.
-unsigned NETgetStatistic(NetStatisticType type, bool sent, bool isTotal)
+uint64_t NETgetStatistic(NetStatisticType type, bool sent, bool isTotal, unsigned player)
 {
-	unsigned Statistic::*statisticType = sent ? &Statistic::sent : &Statistic::received;
+	if (player != NET_ALL_PLAYERS)
+	{
+		Socket *sock = nullptr;
+		if (NetPlay.isHost && player < MAX_CONNECTED_PLAYERS)
+		{
+			sock = connected_bsocket[player];
+		}
+		else if (!NetPlay.isHost && player == NetPlay.hostPlayer)
+		{
+			sock = bsocket;
+		}
+		if (sock == nullptr)
+		{
+			return 0;
+		}
+
+		SocketCompressionStats stats = socketCompressionStats(sock, sent);
+		switch (type)
+		{
+		case NetStatisticRawBytes:                return stats.compressedBytes;
+		case NetStatisticUncompressedBytes:       return stats.uncompressedBytes;
+		case NetStatisticCompressionMicroseconds: return stats.microseconds;
+		default: return 0;
+		}
+	}
+
+	uint64_t Statistic::*statisticType = sent ? &Statistic::sent : &Statistic::received;
 	Statistic NETSTATS::*statsType;
 	switch (type)
 	{
-	case NetStatisticRawBytes:          statsType = &NETSTATS::rawBytes;          break;
-	case NetStatisticUncompressedBytes: statsType = &NETSTATS::uncompressedBytes; break;
-	case NetStatisticPackets:           statsType = &NETSTATS::packets;           break;
+	case NetStatisticRawBytes:                statsType = &NETSTATS::rawBytes;                break;
+	case NetStatisticUncompressedBytes:       statsType = &NETSTATS::uncompressedBytes;       break;
+	case NetStatisticPackets:                 statsType = &NETSTATS::packets;                 break;
+	case NetStatisticCompressionMicroseconds: statsType = &NETSTATS::compressionMicroseconds; break;
 	default: ASSERT(false, " "); return 0;
 	}
 
+	// The sockets keep count of this themselves.
+	nStats.compressionMicroseconds.sent = socketCompressionStats(nullptr, true).microseconds;
+	nStats.compressionMicroseconds.received = socketCompressionStats(nullptr, false).microseconds;
+
 	int time = wzGetTicks();
 	if ((unsigned)(time - nStatsLastUpdateTime) >= (unsigned)GAME_TICKS_PER_SEC)
 	{
@@ -1339,6 +1393,23 @@ unsigned NETgetStatistic(NetStatisticType type, bool sent, bool isTotal)
 }
 
 
+/// Writes the message header and data to the socket, without first copying them into one buffer.
+static ssize_t NETwriteMessage(Socket *sock, NetMessage const *message, size_t *compressedRawLen)
+{
+	uint8_t header[NetMessage::maxRawHeaderLen];
+	size_t headerLen = message->rawHeader(header);
+	size_t compressedHeaderLen = 0, compressedDataLen = 0;
+	ssize_t result = writeAll(sock, header, headerLen, &compressedHeaderLen);
+	if (result == SOCKET_ERROR || message->data.empty())
+	{
+		*compressedRawLen = compressedHeaderLen;
+		return result;
+	}
+	ssize_t dataResult = writeAll(sock, &message->data[0], message->data.size(), &compressedDataLen);
+	*compressedRawLen = compressedHeaderLen + compressedDataLen;
+	return dataResult == SOCKET_ERROR ? SOCKET_ERROR : result + dataResult;
+}
+
 // ////////////////////////////////////////////////////////////////////////
 // Send a message to a player, option to guarantee message
 bool NETsend(NETQUEUE queue, NetMessage const *message)
@@ -1380,11 +1451,9 @@ bool NETsend(NETQUEUE queue, NetMessage const *message)
 			// We are the host, send directly to player.
 			if (sockets[player] != nullptr && player != queue.exclude)
 			{
-				uint8_t *rawData = message->rawDataDup();
 				ssize_t rawLen   = message->rawLen();
 				size_t compressedRawLen;
-				result = writeAll(sockets[player], rawData, rawLen, &compressedRawLen);
-				delete[] rawData;  // Done with the data.
+				result = NETwriteMessage(sockets[player], message, &compressedRawLen);
 
 				if (result == rawLen)
 				{
@@ -1411,11 +1480,9 @@ bool NETsend(NETQUEUE queue, NetMessage const *message)
 		// We are a client, send directly to player, who happens to be the host.
 		if (bsocket)
 		{
-			uint8_t *rawData = message->rawDataDup();
 			ssize_t rawLen   = message->rawLen();
 			size_t compressedRawLen;
-			result = writeAll(bsocket, rawData, rawLen, &compressedRawLen);
-			delete[] rawData;  // Done with the data.
+			result = NETwriteMessage(bsocket, message, &compressedRawLen);
 
 			if (result == rawLen)
 			{
@@ -1547,6 +1614,7 @@ static bool NETprocessSystemMessage(NETQUEUE playerQueue, uint8_t type)
 				      || message->type == NET_COLOURREQUEST
 				      || message->type == NET_POSITIONREQUEST
 				      || message->type == NET_FILE_CANCELLED
+				      || message->type == NET_FILE_RECEIVED
 				      || message->type == NET_JOIN
 				      || message->type == NET_PLAYER_INFO) && receiver != NET_HOST_ONLY))
 				{
@@ -1927,7 +1995,17 @@ bool NETrecvNet(NETQUEUE *queue, uint8_t *type)
 		}
 
 		dataLen = NET_fillBuffer(pSocket, socket_set, buffer, sizeof(buffer));
-		if (dataLen > 0)
+		if (dataLen > 0 && simulatedNetDelay + simulatedNetJitter != 0)
+		{
+			// Hold back the data, keeping it in order, like TCP would.
+			uint32_t releaseTime = wzGetTicks() + simulatedNetDelay + (simulatedNetJitter != 0 ? rand() % (simulatedNetJitter + 1) : 0);
+			if (!delayedNetData[current].empty())
+			{
+				releaseTime = std::max(releaseTime, delayedNetData[current].back().releaseTime);
+			}
+			delayedNetData[current].push_back(DelayedNetData {releaseTime, std::vector<uint8_t>(buffer, buffer + dataLen)});
+		}
+		else if (dataLen > 0)
 		{
 			// we received some data, add to buffer
 			NETinsertRawData(NETnetQueue(current), buffer, dataLen);
@@ -1955,6 +2033,13 @@ bool NETrecvNet(NETQUEUE *queue, uint8_t *type)
 checkMessages:
 	for (current = 0; current < MAX_CONNECTED_PLAYERS; ++current)
 	{
+		std::deque<DelayedNetData> &delayed = delayedNetData[current];
+		while (!delayed.empty() && (int32_t)(wzGetTicks() - delayed.front().releaseTime) >= 0)
+		{
+			NETinsertRawData(NETnetQueue(current), &delayed.front().data[0], delayed.front().data.size());
+			delayed.pop_front();
+		}
+
 		*queue = NETnetQueue(current);
 		while (NETisMessageReady(*queue))
 		{
@@ -1969,8 +2054,20 @@ checkMessages:
 	return false;
 }
 
+void NETsetSimulatedDelay(unsigned delay, unsigned jitter)
+{
+	simulatedNetDelay = delay;
+	simulatedNetJitter = jitter;
+	debug(LOG_WARNING, "Delaying all received network data by %u to %u ms, for testing.", delay, delay + jitter);
+}
+
 bool NETrecvGame(NETQUEUE *queue, uint8_t *type)
 {
+	if (NETisReplay())
+	{
+		NETreplayLoadNetMessages();
+	}
+
 	for (unsigned current = 0; current < MAX_PLAYERS; ++current)
 	{
 		*queue = NETgameQueue(current);
@@ -2008,6 +2105,11 @@ bool NETrecvGame(NETQUEUE *queue, uint8_t *type)
 *         NET_BUFFER_SIZE is at 16k.  (also remember text chat, plus all the other cruff)
 */
 #define MAX_FILE_TRANSFER_PACKET 2048
+#define FILE_TRANSFER_ACK_INTERVAL (16 * MAX_FILE_TRANSFER_PACKET)  ///< Receivers confirm what they have got every this many bytes, see NET_FILE_RECEIVED.
+#define FILE_TRANSFER_MAX_RETRIES 2  ///< Times a downloaded file not matching its hash is downloaded again, before giving up.
+
+static unsigned int fileTransferWindow = 256 * 1024;  ///< Bytes the host may send ahead of what the receiver has confirmed.
+
 int NETsendFile(WZFile &file, unsigned player)
 {
 	ASSERT_OR_RETURN(100, NetPlay.isHost, "Trying to send a file and we are not the host!");
@@ -2034,7 +2136,84 @@ int NETsendFile(WZFile &file, unsigned player)
 		file.handle = nullptr;  // We are done sending to this client.
 	}
 
-	return (uint64_t)file.pos * 100 / file.size;
+	return (uint64_t)file.pos * 100 / std::max<uint32_t>(file.size, 1);
+}
+
+void NETrecvFileReceived(NETQUEUE queue)
+{
+	ASSERT_OR_RETURN(, NetPlay.isHost, "Host only routine detected for client!");
+
+	Sha256 hash;
+	hash.setZero();
+	uint32_t pos = 0;
+	NETbeginDecode(queue, NET_FILE_RECEIVED);
+	NETbin(hash.bytes, hash.Bytes);
+	NETuint32_t(&pos);
+	NETend();
+
+	for (WZFile &file : NetPlay.players[queue.index].wzFiles)
+	{
+		if (file.hash == hash)
+		{
+			file.received = std::max(file.received, std::min(pos, file.pos));
+		}
+	}
+}
+
+static void sendFileRequest(Sha256 hash, uint32_t pos)
+{
+	NETbeginEncode(NETnetQueue(NET_HOST_ONLY), NET_FILE_REQUESTED);
+	NETbin(hash.bytes, hash.Bytes);
+	NETuint32_t(&pos);  // Where to start, if resuming.
+	NETend();
+}
+
+// Truncate a file being downloaded, to get it all again.
+static bool restartFileDownload(WZFile &file)
+{
+	if (file.handle != nullptr)
+	{
+		PHYSFS_close(file.handle);
+	}
+	file.handle = PHYSFS_openWrite(file.fileName.c_str());
+	file.pos = 0;
+	file.received = 0;
+	ASSERT_OR_RETURN(false, file.handle != nullptr, "Could not open %s for writing: %s", file.fileName.c_str(), WZ_PHYSFS_getLastError());
+	return true;
+}
+
+void NETrequestFile(Sha256 const &hash, char const *fileName)
+{
+	// Keep whatever was downloaded last time, and only ask for the rest.
+	PHYSFS_file *handle = nullptr;
+	uint32_t pos = 0;
+	if (PHYSFS_exists(fileName))
+	{
+		handle = PHYSFS_openAppend(fileName);
+		PHYSFS_sint64 length = handle != nullptr ? PHYSFS_fileLength(handle) : -1;
+		if (length >= 0 && length <= 0xFFFFFFFF)
+		{
+			pos = (uint32_t)length;
+		}
+		else if (handle != nullptr)
+		{
+			PHYSFS_close(handle);
+			handle = nullptr;
+		}
+	}
+	if (handle == nullptr)
+	{
+		handle = PHYSFS_openWrite(fileName);
+	}
+	ASSERT_OR_RETURN(, handle != nullptr, "Could not open %s for writing: %s", fileName, WZ_PHYSFS_getLastError());
+
+	if (pos != 0)
+	{
+		debug(LOG_INFO, "Resuming download of %s from byte %u", fileName, pos);
+	}
+	NetPlay.wzFiles.emplace_back(handle, hash, 0, pos);
+	NetPlay.wzFiles.back().fileName = fileName;
+	sendFileRequest(hash, pos);
 }
 
 // recv file. it returns % of the file so far recvd.
@@ -2071,6 +2250,24 @@ int NETrecvFile(NETQUEUE queue)
 		return 100;
 	}
 
+	if (pos != file->pos)
+	{
+		if (pos != 0)
+		{
+			// Sent before the host got our last request, we asked for a different part.
+			debug(LOG_NET, "Ignoring file data at %u, expected %u", pos, file->pos);
+			return (uint64_t)file->pos * 100 / std::max<uint32_t>(size, 1);
+		}
+		// The host couldn't resume from where we were, so it is sending the whole file.
+		debug(LOG_INFO, "Could not resume download of %s, starting again", file->fileName.c_str());
+		if (!restartFileDownload(*file))
+		{
+			return 100;
+		}
+	}
+	ASSERT_OR_RETURN(100, bytesToRead <= size - pos, "Bad value.");
+	file->size = size;
+
 	// Write packet to the file.
 	WZ_PHYSFS_writeBytes(file->handle, buf, bytesToRead);
 
@@ -2088,8 +2285,42 @@ int NETrecvFile(NETQUEUE queue)
 			debug(LOG_ERROR, "Could not close file handle after trying to save map: %s", WZ_PHYSFS_getLastError());
 		}
 		file->handle = nullptr;
+
+		// A resumed download may have started from a bad partial file, which only shows up now. Not using
+		// the hash cache, the file may have been written more than once within the same second.
+		if (findHashOfFileUncached(file->fileName.c_str()) != hash)
+		{
+			if (file->hashMismatches < FILE_TRANSFER_MAX_RETRIES)
+			{
+				++file->hashMismatches;
+				debug(LOG_WARNING, "Downloaded %s doesn't match its hash, downloading it again.", file->fileName.c_str());
+				if (restartFileDownload(*file))
+				{
+					sendFileRequest(hash, 0);
+					return 0;
+				}
+			}
+			else
+			{
+				// Don't keep downloading it forever, and don't resume from it next time.
+				debug(LOG_ERROR, "Downloaded %s doesn't match its hash, giving up.", file->fileName.c_str());
+				NETbeginEncode(NETnetQueue(NET_HOST_ONLY), NET_FILE_CANCELLED);
+				NETbin(hash.bytes, hash.Bytes);
+				NETend();
+				PHYSFS_delete(file->fileName.c_str());
+			}
+		}
 		NetPlay.wzFiles.erase(file);
 	}
+	else if (newPos - file->received >= FILE_TRANSFER_ACK_INTERVAL)
+	{
+		// Let the host send more.
+		file->received = newPos;
+		NETbeginEncode(NETnetQueue(NET_HOST_ONLY), NET_FILE_RECEIVED);
+		NETbin(hash.bytes, hash.Bytes);
+		NETuint32_t(&newPos);
+		NETend();
+	}
 	// 'file' may now be an invalidated iterator.
 
 	//return the percentage count
@@ -2110,7 +2341,8 @@ unsigned NETgetDownloadProgress(unsigned player)
 	uint32_t progress = 100;
 	for (WZFile const &file : files)
 	{
-		progress = std::min<uint32_t>(progress, (uint32_t)((uint64_t)file.pos * 100 / (uint64_t)std::max<uint32_t>(file.size, 1)));
+		uint32_t pos = player == selectedPlayer ? file.pos : file.received;  // What they confirmed, not just what we sent.
+		progress = std::min<uint32_t>(progress, (uint32_t)((uint64_t)pos * 100 / (uint64_t)std::max<uint32_t>(file.size, 1)));
 	}
 	return static_cast<unsigned>(progress);
 }
@@ -3305,6 +3537,23 @@ unsigned int NETgetGameserverPort()
 	return gameserver_port;
 }
 
+/*!
+ * Set how far the host may get ahead of a player downloading a map or mod
+ * \param bytes Bytes sent but not yet confirmed by the player
+ */
+void NETsetFileTransferWindow(unsigned int bytes)
+{
+	fileTransferWindow = std::max<unsigned int>(bytes, 2 * FILE_TRANSFER_ACK_INTERVAL);
+}
+
+/**
+ * @return How many bytes of a file the host may send before the player confirms them.
+ */
+unsigned int NETgetFileTransferWindow()
+{
+	return fileTransferWindow;
+}
+
 /*!
 * Set the join preference for IPv6
 * \param bTryIPv6First Whether to attempt IPv6 first when joining, before IPv4.
@@ -3875,6 +4124,7 @@ const char *messageTypeToString(unsigned messageType_)
 	case NET_DEBUG_SYNC:                return "NET_DEBUG_SYNC";
 	case NET_VOTE:                      return "NET_VOTE";
 	case NET_VOTE_REQUEST:              return "NET_VOTE_REQUEST";
+	case NET_FILE_RECEIVED:             return "NET_FILE_RECEIVED";
 	case NET_MAX_TYPE:                  return "NET_MAX_TYPE";
 
 	// Game-state-related messages, must be processed by all clients at the same game time.
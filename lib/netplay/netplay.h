@@ -92,6 +92,7 @@ enum MESSAGE_TYPES
 	NET_DEBUG_SYNC,                 ///< Synch error messages, so people don't have to use pastebin.
 	NET_VOTE,                       ///< player vote
 	NET_VOTE_REQUEST,               ///< Setup a vote popup
+	NET_FILE_RECEIVED,              ///< Player confirms how much of a file it has received, so the host can send more
 	NET_MAX_TYPE,                   ///< Maximum+1 valid NET_ type, *MUST* be last.
 
 	// Game-state-related messages, must be processed by all clients at the same game time.
@@ -204,12 +205,15 @@ struct SYNC_COUNTER
 struct WZFile
 {
 	//WZFile() : handle(nullptr), size(0), pos(0) { hash.setZero(); }
-	WZFile(PHYSFS_file *handle, Sha256 hash, uint32_t size = 0) : handle(handle), hash(hash), size(size), pos(0) {}
+	WZFile(PHYSFS_file *handle, Sha256 hash, uint32_t size = 0, uint32_t pos = 0) : handle(handle), hash(hash), size(size), pos(pos), received(pos) {}
 
 	PHYSFS_file *handle;
 	Sha256 hash;
 	uint32_t size;
-	uint32_t pos;  // Current position, the range [0; currPos[ has been sent or received already.
+	uint32_t pos;       // Current position, the range [0; currPos[ has been sent or received already.
+	uint32_t received;  // The range [0; received[ has been confirmed by the receiver with NET_FILE_RECEIVED.
+	std::string fileName;  // Only set when receiving, to start again if the download can't be resumed.
+	unsigned hashMismatches = 0;  // Only used when receiving, how many times the whole download didn't match the hash.
 };
 
 enum
@@ -299,8 +303,12 @@ WZ_DECL_NONNULL(1, 2) bool NETrecvNet(NETQUEUE *queue, uint8_t *type);        //
 WZ_DECL_NONNULL(1, 2) bool NETrecvGame(NETQUEUE *queue, uint8_t *type);       ///< recv a message from the game queues which is sceduled to execute by time, if possible.
 void NETflush();                                                              ///< Flushes any data stuck in compression buffers.
 
+void NETsetSimulatedDelay(unsigned delay, unsigned jitter);                  ///< Hold back received data by delay to delay + jitter milliseconds, for testing the latency handling.
+
 int NETsendFile(WZFile &file, unsigned player);  ///< Send file chunk. Returns 100 when done.
 int NETrecvFile(NETQUEUE queue);                 ///< Receive file chunk. Returns 100 when done.
+void NETrecvFileReceived(NETQUEUE queue);        ///< Host only, a player confirmed receiving part of a file.
+WZ_DECL_NONNULL(2) void NETrequestFile(Sha256 const &hash, char const *fileName);  ///< Download a file from the host, resuming if part of it was downloaded before.
 unsigned NETgetDownloadProgress(unsigned player);     ///< Returns 100 when done.
 
 int NETclose();					// close current game
@@ -310,8 +318,8 @@ void NETaddRedirects();
 void NETremRedirects();
 void NETdiscoverUPnPDevices();
 
-enum NetStatisticType {NetStatisticRawBytes, NetStatisticUncompressedBytes, NetStatisticPackets};
-unsigned NETgetStatistic(NetStatisticType type, bool sent, bool isTotal = false);     // Return some statistic. Call regularly for good results.
+enum NetStatisticType {NetStatisticRawBytes, NetStatisticUncompressedBytes, NetStatisticPackets, NetStatisticCompressionMicroseconds};
+uint64_t NETgetStatistic(NetStatisticType type, bool sent, bool isTotal = false, unsigned player = NET_ALL_PLAYERS);     // Return some statistic. Call regularly for good results. Statistics for a single player are totals for the connection to that player, and don't count packets.
 
 void NETplayerKicked(UDWORD index);			// Cleanup after player has been kicked
 
@@ -339,6 +347,8 @@ void NETsetGameserverPort(unsigned int port);
 unsigned int NETgetGameserverPort();
 void NETsetJoinPreferenceIPv6(bool bTryIPv6First);
 bool NETgetJoinPreferenceIPv6();
+void NETsetFileTransferWindow(unsigned int bytes);
+unsigned int NETgetFileTransferWindow();
 
 bool NETsetupTCPIP(const char *machine);
 void NETsetGamePassword(const char *password);
@@ -22,8 +22,11 @@
  * Basic netqueue.
  */
 #include "lib/framework/frame.h"
+#include "lib/framework/wzapp.h"
 #include "netqueue.h"
 
+#include <algorithm>
+
 // See comments in netqueue.h.
 
 
@@ -100,22 +103,19 @@ bool decode_uint32_t(uint8_t b, uint32_t &v, unsigned n)
 	return !isLastByte;
 }
 
-uint8_t *NetMessage::rawDataDup() const
+size_t NetMessage::rawHeader(uint8_t *header) const
 {
 	unsigned encodedLengthOfSize = encodedlength_uint32_t(data.size());
 
-	uint8_t *ret = new uint8_t[1 + encodedLengthOfSize + data.size()];
-
-	ret[0] = type;
+	header[0] = type;
 
 	uint32_t len = data.size();
 	for (unsigned n = 0; n < encodedLengthOfSize; ++n)
 	{
-		encode_uint32_t(ret[n + 1], len, n);
+		encode_uint32_t(header[n + 1], len, n);
 	}
 
-	std::copy(data.begin(), data.end(), ret + 1 + encodedLengthOfSize);
-	return ret;
+	return 1 + encodedLengthOfSize;
 }
 
 size_t NetMessage::rawLen() const
@@ -126,15 +126,16 @@ size_t NetMessage::rawLen() const
 NetQueue::NetQueue()
 	: canGetMessagesForNet(true)
 	, canGetMessages(true)
+	, dataPos(0)
+	, messagePos(0)
 {
-	dataPos = messages.end();
-	messagePos = messages.end();
 }
 
 void NetQueue::writeRawData(const uint8_t *netData, size_t netLen)
 {
 	size_t used = 0;
 	std::vector<uint8_t> &buffer = incompleteReceivedMessageData;  // Short alias.
+	uint32_t now = wzGetTicks();
 
 	// Insert the data.
 	buffer.insert(buffer.end(), netData, netData + netLen);
@@ -159,8 +160,9 @@ void NetQueue::writeRawData(const uint8_t *netData, size_t netLen)
 			break;  // Don't have a whole message ready yet.
 		}
 
-		messages.push_front(NetMessage(type));
-		messages.front().data.assign(buffer.begin() + used + headerLen, buffer.begin() + used + headerLen + len);
+		messages.push_back(NetMessage(type));
+		messages.back().data.assign(buffer.begin() + used + headerLen, buffer.begin() + used + headerLen + len);
+		messages.back().queuedTime = now;
 		used += headerLen + len;
 	}
 
@@ -175,36 +177,25 @@ void NetQueue::setWillNeverGetMessagesForNet()
 
 unsigned NetQueue::numMessagesForNet() const
 {
-	unsigned count = 0;
-	if (canGetMessagesForNet)
-	{
-		for (List::iterator i = dataPos; i != messages.begin(); --i)
-		{
-			++count;
-		}
-	}
-
-	return count;
+	return canGetMessagesForNet ? messages.size() - dataPos : 0;
 }
 
 const NetMessage &NetQueue::getMessageForNet() const
 {
 	ASSERT(canGetMessagesForNet, "Wrong NetQueue type for getMessageForNet.");
-	ASSERT(dataPos != messages.begin(), "No message to get!");
+	ASSERT(dataPos != messages.size(), "No message to get!");
 
 	// Return the message.
-	List::iterator i = dataPos;
-	--i;
-	return *i;
+	return messages[dataPos];
 }
 
 void NetQueue::popMessageForNet()
 {
 	ASSERT(canGetMessagesForNet, "Wrong NetQueue type for popMessageForNet.");
-	ASSERT(dataPos != messages.begin(), "No message to pop!");
+	ASSERT(dataPos != messages.size(), "No message to pop!");
 
 	// Pop the message.
-	--dataPos;
+	++dataPos;
 
 	// Recycle old data.
 	popOldMessages();
@@ -212,7 +203,8 @@ void NetQueue::popMessageForNet()
 
 void NetQueue::pushMessage(const NetMessage &message)
 {
-	messages.push_front(message);
+	messages.push_back(message);
+	messages.back().queuedTime = wzGetTicks();
 }
 
 void NetQueue::setWillNeverGetMessages()
@@ -223,27 +215,25 @@ void NetQueue::setWillNeverGetMessages()
 bool NetQueue::haveMessage() const
 {
 	ASSERT(canGetMessages, "Wrong NetQueue type for haveMessage.");
-	return messagePos != messages.begin();
+	return messagePos != messages.size();
 }
 
 const NetMessage &NetQueue::getMessage() const
 {
 	ASSERT(canGetMessages, "Wrong NetQueue type for getMessage.");
-	ASSERT(messagePos != messages.begin(), "No message to get!");
+	ASSERT(messagePos != messages.size(), "No message to get!");
 
 	// Return the message.
-	List::iterator i = messagePos;
-	--i;
-	return *i;
+	return messages[messagePos];
 }
 
 void NetQueue::popMessage()
 {
 	ASSERT(canGetMessages, "Wrong NetQueue type for popMessage.");
-	ASSERT(messagePos != messages.begin(), "No message to pop!");
+	ASSERT(messagePos != messages.size(), "No message to pop!");
 
 	// Pop the message.
-	--messagePos;
+	++messagePos;
 
 	// Recycle old data.
 	popOldMessages();
@@ -253,27 +243,16 @@ void NetQueue::popOldMessages()
 {
 	if (!canGetMessagesForNet)
 	{
-		dataPos = messages.begin();
+		dataPos = messages.size();
 	}
 	if (!canGetMessages)
 	{
-		messagePos = messages.begin();
-	}
-
-	List::iterator i = messages.end();
-	while (i != dataPos && i != messagePos)
-	{
-		--i;
-	}
-
-	if (i == dataPos)
-	{
-		dataPos = messages.end();  // Old iterator will become invalid.
-	}
-	if (i == messagePos)
-	{
-		messagePos = messages.end();  // Old iterator will become invalid.
+		messagePos = messages.size();
 	}
 
-	messages.erase(i, messages.end());
+	// Erasing from the front of a deque doesn't invalidate references to the other messages.
+	size_t numOld = std::min(dataPos, messagePos);
+	messages.erase(messages.begin(), messages.begin() + numOld);
+	dataPos -= numOld;
+	messagePos -= numOld;
 }
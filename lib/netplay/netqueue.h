@@ -26,7 +26,6 @@
 
 #include "lib/framework/frame.h"
 #include <vector>
-#include <list>
 #include <deque>
 
 // At game level:
@@ -44,11 +43,14 @@
 class NetMessage
 {
 public:
-	NetMessage(uint8_t type_ = 0xFF) : type(type_) {}
-	uint8_t *rawDataDup() const;  ///< Returns data compatible with NetQueue::writeRawData(). Must be delete[]d.
-	size_t rawLen() const;        ///< Returns the length of the return value of rawDataDup().
+	enum { maxRawHeaderLen = 1 + 5 };  ///< Type, and length of data encoded with encode_uint32_t.
+
+	NetMessage(uint8_t type_ = 0xFF) : type(type_), queuedTime(0) {}
+	size_t rawHeader(uint8_t *header) const;  ///< Writes the header which, followed by data, is compatible with NetQueue::writeRawData(). header must have room for maxRawHeaderLen bytes. Returns the header length.
+	size_t rawLen() const;        ///< Returns the length of the header and data.
 	uint8_t type;
 	std::vector<uint8_t> data;
+	uint32_t queuedTime;          ///< wzGetTicks() when the message was added to the NetQueue, not sent over the network.
 };
 
 /// MessageWriter is used for serialising, using the same interface as MessageReader.
@@ -123,10 +125,10 @@ private:
 	bool canGetMessagesForNet;                                         ///< True if we will send the messages over the network, false if we don't.
 	bool canGetMessages;                                               ///< True if we will get the messages, false if we don't use them ourselves.
 
-	typedef std::list<NetMessage> List;
-	List::iterator                dataPos;                             ///< Last message which was sent over the network.
-	List::iterator                messagePos;                          ///< Last message which was popped.
-	List                          messages;                            ///< List of messages. Messages are added to the front and read from the back.
+	typedef std::deque<NetMessage> List;
+	size_t                        dataPos;                             ///< Number of messages at the front which were sent over the network.
+	size_t                        messagePos;                          ///< Number of messages at the front which were popped.
+	List                          messages;                            ///< List of messages. Messages are added to the back and read from the front.
 	std::vector<uint8_t>          incompleteReceivedMessageData;       ///< Data from network which has not yet formed an entire message.
 };
 
@@ -0,0 +1,278 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2020  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/**
+ * @file netreplay.cpp
+ *
+ * Recording and playing back the game queue messages of a game.
+ */
+
+#include "lib/framework/frame.h"
+#include <physfs.h>
+#include "lib/framework/physfs_ext.h"
+
+#include "netreplay.h"
+#include "netqueue.h"
+#include "nettypes.h"
+
+#include <vector>
+
+// File format:
+//   "WZreplay"                                       magic
+//   uint32_t                                         format version, big endian
+//   uint32_t, char[]                                 length of the settings, and the settings
+//   { uint8_t player, NetMessage raw data }...       game queue messages, in the order they were processed
+//   uint8_t replayEndMarker
+static const char replayMagic[8] = {'W', 'Z', 'r', 'e', 'p', 'l', 'a', 'y'};
+static const uint32_t replayFormatVersion = 1;
+static const uint8_t replayEndMarker = 0xFF;  ///< Written instead of a player index after the last message.
+
+static const size_t replaySaveBufferSize = 64 * 1024;  ///< Write to the file in chunks of about this size.
+static const unsigned replayMaxQueuedMessages = 4096;  ///< Stop inserting messages when the game queues have this many, so a long replay isn't all decoded at once.
+
+static PHYSFS_file *replaySaveHandle = nullptr;
+static std::vector<uint8_t> replaySaveBuffer;
+
+static bool replayLoading = false;
+static std::vector<uint8_t> replayLoadData;
+static size_t replayLoadPos = 0;
+static unsigned replayQueuedMessages = 0;
+static bool replayDesynched = false;
+static uint32_t replayDesynchGameTime = 0;
+static unsigned replayDesynchPlayer = 0;
+
+static void appendUint32(std::vector<uint8_t> &buffer, uint32_t v)
+{
+	uint8_t b[4] = {uint8_t(v >> 24), uint8_t(v >> 16), uint8_t(v >> 8), uint8_t(v)};
+	buffer.insert(buffer.end(), b, b + 4);
+}
+
+static uint32_t readUint32(const uint8_t *b)
+{
+	return uint32_t(b[0]) << 24 | uint32_t(b[1]) << 16 | uint32_t(b[2]) << 8 | b[3];
+}
+
+static bool replayFlush()
+{
+	if (replaySaveBuffer.empty())
+	{
+		return true;
+	}
+	bool written = WZ_PHYSFS_writeBytes(replaySaveHandle, &replaySaveBuffer[0], replaySaveBuffer.size()) == static_cast<PHYSFS_sint64>(replaySaveBuffer.size());
+	replaySaveBuffer.clear();
+	if (!written)
+	{
+		debug(LOG_ERROR, "Could not write replay: %s", WZ_PHYSFS_getLastError());
+		PHYSFS_close(replaySaveHandle);
+		replaySaveHandle = nullptr;
+	}
+	return written;
+}
+
+bool NETreplaySaveStart(const char *fileName, const std::string &settings)
+{
+	NETreplaySaveStop();
+
+	replaySaveHandle = PHYSFS_openWrite(fileName);
+	if (replaySaveHandle == nullptr)
+	{
+		debug(LOG_ERROR, "Could not create replay %s: %s", fileName, WZ_PHYSFS_getLastError());
+		return false;
+	}
+
+	replaySaveBuffer.clear();
+	replaySaveBuffer.reserve(replaySaveBufferSize + 1000);
+	replaySaveBuffer.insert(replaySaveBuffer.end(), replayMagic, replayMagic + sizeof(replayMagic));
+	appendUint32(replaySaveBuffer, replayFormatVersion);
+	appendUint32(replaySaveBuffer, settings.size());
+	replaySaveBuffer.insert(replaySaveBuffer.end(), settings.begin(), settings.end());
+
+	debug(LOG_NET, "Recording replay to %s", fileName);
+	return replayFlush();
+}
+
+bool NETreplaySaveStop()
+{
+	if (replaySaveHandle == nullptr)
+	{
+		return false;
+	}
+
+	replaySaveBuffer.push_back(replayEndMarker);
+	bool ok = replayFlush();
+	if (replaySaveHandle != nullptr)
+	{
+		ok = PHYSFS_close(replaySaveHandle) != 0 && ok;
+		replaySaveHandle = nullptr;
+	}
+	replaySaveBuffer = std::vector<uint8_t>();
+	return ok;
+}
+
+void NETreplaySaveNetMessage(NetMessage const *message, uint8_t player)
+{
+	if (replaySaveHandle == nullptr)
+	{
+		return;
+	}
+
+	uint8_t header[NetMessage::maxRawHeaderLen];
+	size_t headerLen = message->rawHeader(header);
+	replaySaveBuffer.push_back(player);
+	replaySaveBuffer.insert(replaySaveBuffer.end(), header, header + headerLen);
+	replaySaveBuffer.insert(replaySaveBuffer.end(), message->data.begin(), message->data.end());
+
+	if (replaySaveBuffer.size() >= replaySaveBufferSize)
+	{
+		replayFlush();
+	}
+}
+
+bool NETreplayLoadStart(const char *fileName, std::string *settings)
+{
+	NETreplayLoadStop();
+
+	PHYSFS_file *fileHandle = PHYSFS_openRead(fileName);
+	if (fileHandle == nullptr)
+	{
+		debug(LOG_ERROR, "Could not open replay %s: %s", fileName, WZ_PHYSFS_getLastError());
+		return false;
+	}
+	PHYSFS_sint64 fileSize = PHYSFS_fileLength(fileHandle);
+	std::vector<uint8_t> data(std::max<PHYSFS_sint64>(fileSize, 0));
+	bool read = fileSize > 0 && WZ_PHYSFS_readBytes(fileHandle, &data[0], data.size()) == fileSize;
+	PHYSFS_close(fileHandle);
+
+	if (!read || data.size() < sizeof(replayMagic) + 8 || memcmp(&data[0], replayMagic, sizeof(replayMagic)) != 0)
+	{
+		debug(LOG_ERROR, "%s is not a replay", fileName);
+		return false;
+	}
+	uint32_t version = readUint32(&data[sizeof(replayMagic)]);
+	uint32_t settingsSize = readUint32(&data[sizeof(replayMagic) + 4]);
+	size_t settingsStart = sizeof(replayMagic) + 8;
+	if (version != replayFormatVersion || settingsSize > data.size() - settingsStart)
+	{
+		debug(LOG_ERROR, "Replay %s has unsupported version %u, or is corrupt", fileName, version);
+		return false;
+	}
+
+	settings->assign(data.begin() + settingsStart, data.begin() + settingsStart + settingsSize);
+	replayLoadData = std::move(data);
+	replayLoadPos = settingsStart + settingsSize;
+	replayQueuedMessages = 0;
+	replayDesynched = false;
+	replayLoading = true;
+
+	debug(LOG_NET, "Playing back replay %s", fileName);
+	return true;
+}
+
+bool NETreplayLoadStop()
+{
+	if (!replayLoading)
+	{
+		return false;
+	}
+
+	replayLoading = false;
+	replayLoadData = std::vector<uint8_t>();
+	replayLoadPos = 0;
+	replayQueuedMessages = 0;
+	return true;
+}
+
+void NETreplayLoadNetMessages()
+{
+	const std::vector<uint8_t> &data = replayLoadData;  // Short alias.
+
+	while (replayLoading && replayQueuedMessages < replayMaxQueuedMessages && replayLoadPos < data.size())
+	{
+		size_t pos = replayLoadPos;
+		uint8_t player = data[pos++];
+		if (player == replayEndMarker)
+		{
+			debug(LOG_NET, "End of replay");
+			replayLoadPos = data.size();
+			break;
+		}
+
+		// Same encoding as NetQueue::writeRawData().
+		if (player >= MAX_PLAYERS || pos >= data.size())
+		{
+			break;
+		}
+		NetMessage message(data[pos++]);
+		uint32_t len = 0;
+		bool moreBytes = true;
+		for (unsigned n = 0; moreBytes && n < 5 && pos < data.size(); ++n)
+		{
+			moreBytes = decode_uint32_t(data[pos++], len, n);
+		}
+		if (moreBytes || len > data.size() - pos)
+		{
+			break;
+		}
+		message.data.assign(data.begin() + pos, data.begin() + pos + len);
+		replayLoadPos = pos + len;
+
+		NETinsertMessageFromNet(NETgameQueue(player), &message);
+		++replayQueuedMessages;
+	}
+
+	if (replayLoadPos < data.size() && replayQueuedMessages < replayMaxQueuedMessages && replayLoading)
+	{
+		debug(LOG_ERROR, "Replay is corrupt at byte %lu, stopping playback there.", (unsigned long)replayLoadPos);
+		replayLoadPos = data.size();
+	}
+}
+
+void NETreplayPoppedNetMessage()
+{
+	if (replayQueuedMessages > 0)
+	{
+		--replayQueuedMessages;
+	}
+}
+
+bool NETisReplay()
+{
+	return replayLoading;
+}
+
+bool NETreplayFinished()
+{
+	return replayLoading && replayLoadPos >= replayLoadData.size();
+}
+
+void NETreplayDesynch(uint32_t gameTime, unsigned player)
+{
+	if (!replayDesynched)
+	{
+		replayDesynched = true;
+		replayDesynchGameTime = gameTime;
+		replayDesynchPlayer = player;
+	}
+}
+
+bool NETreplayFirstDesynch(uint32_t *gameTime, unsigned *player)
+{
+	*gameTime = replayDesynchGameTime;
+	*player = replayDesynchPlayer;
+	return replayDesynched;
+}
@@ -0,0 +1,54 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2020  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/**
+ * @file netreplay.h
+ *
+ * Recording and playing back the game queue messages of a game.
+ *
+ * The game queues carry everything which affects the simulation, so a replay is
+ * the game settings followed by the game queue messages, in the order they were
+ * processed. Playing back inserts the messages into the game queues again, and
+ * drops the messages the local player would have added.
+ *
+ * The recorded GAME_GAME_TIME messages include the synch CRCs of every player, so
+ * playing back also checks that the simulation still gives the same results.
+ */
+
+#ifndef _netreplay_h
+#define _netreplay_h
+
+#include "lib/framework/frame.h"
+#include <string>
+
+class NetMessage;
+
+WZ_DECL_NONNULL(1) bool NETreplaySaveStart(const char *fileName, const std::string &settings);  ///< Start recording, settings is whatever is needed to set up the same game again.
+bool NETreplaySaveStop();                                                                       ///< Finish writing the replay.
+WZ_DECL_NONNULL(1) void NETreplaySaveNetMessage(NetMessage const *message, uint8_t player);     ///< Record a message popped from a game queue.
+
+WZ_DECL_NONNULL(1, 2) bool NETreplayLoadStart(const char *fileName, std::string *settings);     ///< Open a replay, and return the settings it was recorded with.
+bool NETreplayLoadStop();                                                                       ///< Stop playing back.
+void NETreplayLoadNetMessages();                                                                ///< Insert the next recorded messages into the game queues, if they are running low.
+void NETreplayPoppedNetMessage();                                                               ///< A message inserted by NETreplayLoadNetMessages was popped.
+bool NETisReplay();                                                                             ///< True while playing back a replay.
+bool NETreplayFinished();                                                                       ///< True when all recorded messages have been inserted into the game queues.
+void NETreplayDesynch(uint32_t gameTime, unsigned player);                                      ///< A synch check recorded from the player failed.
+WZ_DECL_NONNULL(1, 2) bool NETreplayFirstDesynch(uint32_t *gameTime, unsigned *player);         ///< Get the first failed synch check, returns false if there wasn't one.
+
+#endif // _netreplay_h
@@ -30,12 +30,17 @@
 #include <vector>
 #include <algorithm>
 #include <map>
+#include <chrono>
 
 #if !defined(ZLIB_CONST)
 #  define ZLIB_CONST
 #endif
 #include <zlib.h>
 
+#if defined(WZ_OS_LINUX)
+#  include <sys/epoll.h>
+#endif
+
 enum
 {
 	SOCK_CONNECTION,
@@ -73,11 +78,24 @@ struct Socket
 	bool zInflateNeedInput;
 	std::vector<uint8_t> zDeflateOutBuf;
 	std::vector<uint8_t> zInflateInBuf;
+
+	SocketCompressionStats compressionStats[2];  ///< Received, sent.
 };
 
+/* On Linux, sets made by allocSocketSet() are polled with an edge-triggered epoll instance,
+ * so checkSockets() only gets told about the sockets that became readable. A Socket then
+ * stays ready until a read leaves nothing behind, since there won't be another edge until
+ * more data arrives. Temporary sets, and sets on other platforms, use select().
+ */
 struct SocketSet
 {
+	SocketSet() {}
+	explicit SocketSet(Socket *sock) : fds(1, sock) {}
+
 	std::vector<Socket *> fds;
+#if defined(WZ_OS_LINUX)
+	int epollFd = -1;
+#endif
 };
 
 
@@ -91,6 +109,28 @@ static SocketThreadWriteMap socketThreadWrites;
 
 static void socketCloseNow(Socket *sock);
 
+/* Any deflate level can be inflated by the other end, so this only trades bandwidth for CPU time on
+ * our side. The host compresses everything relayed between the players, so use the fastest level.
+ * zlib is the only codec because the build only depends on zlib. A faster codec such as LZ4 or zstd
+ * would need a new library for every platform, and then a NETCODE_VERSION_MINOR bump to agree on it.
+ */
+static const int socketCompressionLevel = Z_BEST_SPEED;
+
+static SocketCompressionStats socketTotalCompressionStats[2];  ///< Received, sent. Only touched by the main thread, which does all the (de)compression.
+
+typedef std::chrono::steady_clock CompressionClock;
+
+static void addCompressionStats(Socket *sock, bool sent, size_t uncompressedBytes, size_t compressedBytes, CompressionClock::time_point start)
+{
+	uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(CompressionClock::now() - start).count();
+	for (SocketCompressionStats *stats : {&sock->compressionStats[sent], &socketTotalCompressionStats[sent]})
+	{
+		stats->uncompressedBytes += uncompressedBytes;
+		stats->compressedBytes += compressedBytes;
+		stats->microseconds += microseconds;
+	}
+}
+
 
 bool socketReadReady(Socket const *sock)
 {
@@ -346,7 +386,7 @@ const char *strSockError(int error)
  */
 static bool connectionIsOpen(Socket *sock)
 {
-	const SocketSet set = {std::vector<Socket *>(1, sock)};
+	const SocketSet set(sock);
 
 	ASSERT_OR_RETURN((setSockErr(EBADF), false),
 	                 sock && sock->fd[SOCK_CONNECTION] != INVALID_SOCKET, "Invalid socket");
@@ -500,9 +540,30 @@ static int socketThreadFunction(void *)
 	return 42;  // Return value arbitrary and unused.
 }
 
+/**
+ * If the last recv() failed because there was nothing to read, marks the socket as not
+ * ready. That happens when an edge-triggered set said the socket was ready, but the data
+ * was already read.
+ */
+static bool socketReadWouldBlock(Socket *sock)
+{
+	switch (getSockErr())
+	{
+	case EAGAIN:
+#if defined(EWOULDBLOCK) && EAGAIN != EWOULDBLOCK
+	case EWOULDBLOCK:
+#endif
+		sock->ready = false;
+		return true;
+	default:
+		return false;
+	}
+}
+
 /**
  * Similar to read(2) with the exception that this function won't be
- * interrupted by signals (EINTR).
+ * interrupted by signals (EINTR). Returns 0 without setting
+ * socketReadDisconnected() if there was nothing to read.
  */
 ssize_t readNoInt(Socket *sock, void *buf, size_t max_size, size_t *rawByteCount)
 {
@@ -534,8 +595,9 @@ ssize_t readNoInt(Socket *sock, void *buf, size_t max_size, size_t *rawByteCount
 			while (received == SOCKET_ERROR && getSockErr() == EINTR);
 			if (received < 0)
 			{
-				return received;
+				return socketReadWouldBlock(sock) ? 0 : received;
 			}
+			sock->ready = received == (ssize_t)sock->zInflateInBuf.size();  // Filled the buffer, so there may be more to read.
 
 			sock->zInflate.next_in = &sock->zInflateInBuf[0];
 			sock->zInflate.avail_in = received;
@@ -551,9 +613,11 @@ ssize_t readNoInt(Socket *sock, void *buf, size_t max_size, size_t *rawByteCount
 			}
 		}
 
+		CompressionClock::time_point start = CompressionClock::now();
 		sock->zInflate.next_out = (Bytef *)buf;
 		sock->zInflate.avail_out = max_size;
 		int ret = inflate(&sock->zInflate, Z_NO_FLUSH);
+		addCompressionStats(sock, false, max_size - sock->zInflate.avail_out, rawBytes, start);
 		ASSERT(ret != Z_STREAM_ERROR, "zlib inflate not working!");
 		char const *err = nullptr;
 		switch (ret)
@@ -588,7 +652,12 @@ ssize_t readNoInt(Socket *sock, void *buf, size_t max_size, size_t *rawByteCount
 	}
 	while (received == SOCKET_ERROR && getSockErr() == EINTR);
 
-	sock->ready = false;
+	if (received == SOCKET_ERROR && socketReadWouldBlock(sock))
+	{
+		return 0;
+	}
+
+	sock->ready = received == (ssize_t)max_size;  // Filled the buffer, so there may be more to read.
 
 	rawBytes = received;
 	return received;
@@ -666,6 +735,8 @@ ssize_t writeAll(Socket *sock, const void *buf, size_t size, size_t *rawByteCoun
 
 			sock->zDeflate.avail_in = size;
 			sock->zDeflateInSize += sock->zDeflate.avail_in;
+			size_t outBufSize = sock->zDeflateOutBuf.size();
+			CompressionClock::time_point start = CompressionClock::now();
 			do
 			{
 				size_t alreadyHave = sock->zDeflateOutBuf.size();
@@ -680,6 +751,7 @@ ssize_t writeAll(Socket *sock, const void *buf, size_t size, size_t *rawByteCoun
 				sock->zDeflateOutBuf.resize(sock->zDeflateOutBuf.size() - sock->zDeflate.avail_out);
 			}
 			while (sock->zDeflate.avail_out == 0);
+			addCompressionStats(sock, true, size, sock->zDeflateOutBuf.size() - outBufSize, start);
 
 			ASSERT(sock->zDeflate.avail_in == 0, "zlib didn't compress everything!");
 		}
@@ -700,6 +772,8 @@ void socketFlush(Socket *sock, size_t *rawByteCount)
 	}
 
 	// Flush data out of zlib compression state.
+	size_t outBufSize = sock->zDeflateOutBuf.size();
+	CompressionClock::time_point start = CompressionClock::now();
 	do
 	{
 		sock->zDeflate.next_in = (Bytef *)nullptr;
@@ -716,6 +790,7 @@ void socketFlush(Socket *sock, size_t *rawByteCount)
 		sock->zDeflateOutBuf.resize(sock->zDeflateOutBuf.size() - sock->zDeflate.avail_out);
 	}
 	while (sock->zDeflate.avail_out == 0);
+	addCompressionStats(sock, true, 0, sock->zDeflateOutBuf.size() - outBufSize, start);
 
 	if (sock->zDeflateOutBuf.empty())
 	{
@@ -755,7 +830,7 @@ void socketBeginCompression(Socket *sock)
 	sock->zDeflate.zalloc = Z_NULL;
 	sock->zDeflate.zfree = Z_NULL;
 	sock->zDeflate.opaque = Z_NULL;
-	int ret = deflateInit(&sock->zDeflate, 6);
+	int ret = deflateInit(&sock->zDeflate, socketCompressionLevel);
 	ASSERT(ret == Z_OK, "deflateInit failed! Sockets won't work.");
 
 	sock->zInflate.zalloc = Z_NULL;
@@ -772,6 +847,17 @@ void socketBeginCompression(Socket *sock)
 	wzMutexUnlock(socketThreadMutex);
 }
 
+SocketCompressionStats socketCompressionStats(Socket const *sock, bool sent)
+{
+	return sock != nullptr ? sock->compressionStats[sent] : socketTotalCompressionStats[sent];
+}
+
+void socketResetCompressionStats()
+{
+	socketTotalCompressionStats[0] = SocketCompressionStats();
+	socketTotalCompressionStats[1] = SocketCompressionStats();
+}
+
 Socket::~Socket()
 {
 	if (isCompressed)
@@ -781,13 +867,38 @@ Socket::~Socket()
 	}
 }
 
+#if defined(WZ_OS_LINUX)
+/**
+ * Go back to select() for this set, if epoll couldn't be used.
+ */
+static void socketSetDisableEpoll(SocketSet *set)
+{
+	if (set->epollFd != -1)
+	{
+		close(set->epollFd);
+		set->epollFd = -1;
+	}
+}
+#endif
+
 SocketSet *allocSocketSet()
 {
-	return new SocketSet;
+	SocketSet *set = new SocketSet;
+#if defined(WZ_OS_LINUX)
+	set->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (set->epollFd == -1)
+	{
+		debug(LOG_NET, "epoll_create1 failed, using select: %s", strSockError(getSockErr()));
+	}
+#endif
+	return set;
 }
 
 void deleteSocketSet(SocketSet *set)
 {
+#if defined(WZ_OS_LINUX)
+	socketSetDisableEpoll(set);
+#endif
 	delete set;
 }
 
@@ -810,6 +921,22 @@ void SocketSet_AddSocket(SocketSet *set, Socket *socket)
 
 	set->fds.push_back(socket);
 	debug(LOG_NET, "Socket added: set->fds[%lu] = %p", (unsigned long)i, static_cast<void *>(socket));
+
+#if defined(WZ_OS_LINUX)
+	if (set->epollFd != -1)
+	{
+		// If there is already something to read, the first epoll_wait reports it.
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		event.data.ptr = socket;
+		if (epoll_ctl(set->epollFd, EPOLL_CTL_ADD, socket->fd[SOCK_CONNECTION], &event) == -1)
+		{
+			debug(LOG_ERROR, "epoll_ctl failed, using select: %s", strSockError(getSockErr()));
+			socketSetDisableEpoll(set);
+		}
+	}
+#endif
 }
 
 /**
@@ -822,6 +949,13 @@ void SocketSet_DelSocket(SocketSet *set, Socket *socket)
 	{
 		debug(LOG_NET, "Socket %p erased (set->fds[%lu])", static_cast<void *>(socket), (unsigned long)i);
 		set->fds.erase(set->fds.begin() + i);
+#if defined(WZ_OS_LINUX)
+		// Fails harmlessly if the socket was already closed, which removes it from the epoll set anyway.
+		if (set->epollFd != -1 && socket->fd[SOCK_CONNECTION] != INVALID_SOCKET)
+		{
+			epoll_ctl(set->epollFd, EPOLL_CTL_DEL, socket->fd[SOCK_CONNECTION], nullptr);
+		}
+#endif
 	}
 }
 
@@ -918,6 +1052,43 @@ static void socketBlockSIGPIPE(const SOCKET fd, bool block_sigpipe)
 #endif
 }
 
+#if defined(WZ_OS_LINUX)
+static int checkSocketsEpoll(const SocketSet *set, unsigned int timeout)
+{
+	// Sockets which weren't read dry, or which have decompressed data waiting, are still ready without a new edge.
+	int ret = 0;
+	for (Socket *sock : set->fds)
+	{
+		sock->ready = sock->ready || (sock->isCompressed && !sock->zInflateNeedInput);
+		ret += sock->ready;
+	}
+
+	struct epoll_event events[64];
+	int numEvents;
+	do
+	{
+		numEvents = epoll_wait(set->epollFd, events, ARRAY_SIZE(events), ret > 0 ? 0 : (int)std::min<unsigned>(timeout, INT_MAX));
+	}
+	while (numEvents == -1 && getSockErr() == EINTR);
+
+	if (numEvents == -1)
+	{
+		debug(LOG_ERROR, "epoll_wait failed: %s", strSockError(getSockErr()));
+		return SOCKET_ERROR;
+	}
+
+	// Any events beyond the array size stay queued for the next call.
+	for (int i = 0; i < numEvents; ++i)
+	{
+		Socket *sock = static_cast<Socket *>(events[i].data.ptr);
+		ret += !sock->ready;
+		sock->ready = true;
+	}
+
+	return ret;
+}
+#endif
+
 int checkSockets(const SocketSet *set, unsigned int timeout)
 {
 	if (set->fds.empty())
@@ -925,6 +1096,13 @@ int checkSockets(const SocketSet *set, unsigned int timeout)
 		return 0;
 	}
 
+#if defined(WZ_OS_LINUX)
+	if (set->epollFd != -1)
+	{
+		return checkSocketsEpoll(set, timeout);
+	}
+#endif
+
 #if   defined(WZ_OS_UNIX)
 	SOCKET maxfd = INT_MIN;
 #elif defined(WZ_OS_WIN)
@@ -1008,7 +1186,7 @@ ssize_t readAll(Socket *sock, void *buf, size_t size, unsigned int timeout)
 {
 	ASSERT(!sock->isCompressed, "readAll on compressed sockets not implemented.");
 
-	const SocketSet set = {std::vector<Socket *>(1, sock)};
+	const SocketSet set(sock);
 
 	size_t received = 0;
 
@@ -1041,7 +1219,7 @@ ssize_t readAll(Socket *sock, void *buf, size_t size, unsigned int timeout)
 		}
 
 		ret = recv(sock->fd[SOCK_CONNECTION], &((char *)buf)[received], size - received, 0);
-		sock->ready = false;
+		sock->ready = ret == (ssize_t)(size - received);  // Got everything asked for, so there may be more to read.
 		if (ret == 0)
 		{
 			debug(LOG_NET, "Socket %x disconnected.", sock->fd[SOCK_CONNECTION]);
@@ -1560,6 +1738,33 @@ char const *getSocketTextAddress(Socket const *sock)
 	return sock->textAddress;
 }
 
+unsigned getSocketPort(Socket const *sock)
+{
+	// A listening socket may have separate IPv4 and IPv6 sockets, with different ports if listening on port 0. Prefer the IPv4 one.
+	for (unsigned i = 0; i < ARRAY_SIZE(sock->fd); ++i)
+	{
+		if (sock->fd[i] != INVALID_SOCKET)
+		{
+			struct sockaddr_storage addr;
+			socklen_t addr_len = sizeof(addr);
+			if (getsockname(sock->fd[i], (struct sockaddr *)&addr, &addr_len) == SOCKET_ERROR)
+			{
+				debug(LOG_ERROR, "getsockname failed for socket %p: %s", static_cast<void const *>(sock), strSockError(getSockErr()));
+				continue;
+			}
+			if (addr.ss_family == AF_INET)
+			{
+				return ntohs(((struct sockaddr_in *)&addr)->sin_port);
+			}
+			if (addr.ss_family == AF_INET6)
+			{
+				return ntohs(((struct sockaddr_in6 *)&addr)->sin6_port);
+			}
+		}
+	}
+	return 0;
+}
+
 std::vector<unsigned char> ipv4_AddressString_To_NetBinary(const std::string& ipv4Address)
 {
 	std::vector<unsigned char> binaryForm(sizeof(struct in_addr), 0);
@@ -1690,6 +1895,8 @@ void SOCKETinit()
 
 	if (socketThread == nullptr)
 	{
+		socketResetCompressionStats();
+
 		socketThreadQuit = false;
 		socketThreadMutex = wzMutexCreate();
 		socketThreadSemaphore = wzSemaphoreCreate(0);
@@ -106,6 +106,7 @@ WZ_DECL_NONNULL(1) bool socketHasIPv4(Socket *sock);
 WZ_DECL_NONNULL(1) bool socketHasIPv6(Socket *sock);
 
 WZ_DECL_NONNULL(1) char const *getSocketTextAddress(Socket const *sock); ///< Gets a string with the socket address.
+WZ_DECL_NONNULL(1) unsigned getSocketPort(Socket const *sock);          ///< Gets the local port of the Socket, such as the one picked for socketListen(0). Returns 0 on error.
 std::vector<unsigned char> ipv4_AddressString_To_NetBinary(const std::string& ipv4Address);
 std::vector<unsigned char> ipv6_AddressString_To_NetBinary(const std::string& ipv6Address);
 std::string ipv4_NetBinary_To_AddressString(const std::vector<unsigned char>& ip4NetBinaryForm);
@@ -119,9 +120,18 @@ WZ_DECL_NONNULL(1, 2)
 ssize_t writeAll(Socket *sock, const void *buf, size_t size, size_t *rawByteCount = nullptr);  ///< Nonblocking write of size bytes to the Socket. All bytes will be written asynchronously, by a separate thread. Raw count of bytes (after compression) returned in rawByteCount, which will often be 0 until the socket is flushed.
 
 // Sockets, compressed.
+struct SocketCompressionStats
+{
+	uint64_t uncompressedBytes = 0;
+	uint64_t compressedBytes = 0;
+	uint64_t microseconds = 0;  ///< Time spent in zlib.
+};
+
 WZ_DECL_NONNULL(1) void socketBeginCompression(Socket *sock); ///< Makes future data sent compressed, and future data received expected to be compressed.
 WZ_DECL_NONNULL(1) bool socketReadDisconnected(Socket *sock);  ///< If readNoInt returned 0, returns true if this is the result of a disconnect, or false if the input compressed data just hasn't produced any output bytes.
 WZ_DECL_NONNULL(1) void socketFlush(Socket *sock, size_t *rawByteCount = nullptr); ///< Actually sends the data written with writeAll. Only useful on compressed sockets. Note that flushing too often makes compression less effective. Raw count of bytes (after compression) returned in rawByteCount.
+SocketCompressionStats socketCompressionStats(Socket const *sock, bool sent);  ///< Returns how much data sent or received on the Socket was compressed, and how long it took. If sock is nullptr, returns the totals for all Sockets since the last socketResetCompressionStats.
+void socketResetCompressionStats();                                            ///< Zeroes the totals returned by socketCompressionStats(nullptr, sent).
 
 // Socket sets.
 WZ_DECL_ALLOCATION SocketSet *allocSocketSet();                         ///< Constructs a SocketSet.
@@ -34,12 +34,15 @@
 #endif
 
 #include "../framework/frame.h"
+#include "../framework/wzapp.h"
 #include "netplay.h"
 #include "nettypes.h"
 #include "netqueue.h"
 #include "netlog.h"
+#include "netreplay.h"
 #include "src/order.h"
 #include <cstring>
+#include <chrono>
 
 /// There is a game queue representing each player. The game queues are synchronised among all players, so that all players process the same game queue
 /// messages at the same game time. The game queues should be used, even in single-player. Players should write to their own queue, not to other player's
@@ -61,6 +64,7 @@ static MessageWriter writer;  ///< Used when serialising a message.
 static MessageReader reader;  ///< Used when deserialising a message.
 static NetMessage message;    ///< A message which is being serialised or deserialised.
 static NETQUEUE queueInfo;    ///< Indicates which queue is currently being (de)serialised.
+static std::chrono::steady_clock::time_point messageStartTime;  ///< When the message started being (de)serialised.
 static PACKETDIR NetDir;      ///< Indicates whether a message is being serialised (PACKET_ENCODE) or deserialised (PACKET_DECODE), or not doing anything (PACKET_INVALID).
 
 static void NETsetPacketDir(PACKETDIR dir)
@@ -454,8 +458,10 @@ void NETbeginEncode(NETQUEUE queue, uint8_t type)
 	NETsetPacketDir(PACKET_ENCODE);
 
 	queueInfo = queue;
-	message = type;
+	message.type = type;
+	message.data.clear();  // Keeps the capacity, so encoding doesn't have to grow the buffer again for every message.
 	writer = MessageWriter(message);
+	messageStartTime = std::chrono::steady_clock::now();
 }
 
 void NETbeginDecode(NETQUEUE queue, uint8_t type)
@@ -465,15 +471,27 @@ void NETbeginDecode(NETQUEUE queue, uint8_t type)
 	queueInfo = queue;
 	message = receiveQueue(queueInfo)->getMessage();
 	reader = MessageReader(message);
+	messageStartTime = std::chrono::steady_clock::now();
 
 	assert(type == message.type);
 }
 
 bool NETend()
 {
+	uint32_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - messageStartTime).count();
+
 	// If we are encoding just return true
 	if (NETgetPacketDir() == PACKET_ENCODE)
 	{
+		NETlogPacketTime(message.type, microseconds, false);
+
+		if (NETisReplay() && (queueInfo.queueType == QUEUE_GAME || queueInfo.queueType == QUEUE_GAME_FORCED))
+		{
+			// The recorded messages are played back instead.
+			NETsetPacketDir(PACKET_INVALID);
+			return true;
+		}
+
 		// Push the message onto the list.
 		NetQueue *queue = sendQueue(queueInfo);
 		if (queue == nullptr) {
@@ -540,6 +558,7 @@ bool NETend()
 
 	if (NETgetPacketDir() == PACKET_DECODE)
 	{
+		NETlogPacketTime(message.type, microseconds, true);
 		bool ret = reader.valid();
 
 		// We have ended the deserialisation, so mark the direction invalid
@@ -585,6 +604,20 @@ void NETflushGameQueues()
 
 void NETpop(NETQUEUE queue)
 {
+	NetMessage const &popped = receiveQueue(queue)->getMessage();
+	NETlogPacketQueued(popped.type, wzGetTicks() - popped.queuedTime);
+
+	if (queue.queueType == QUEUE_GAME)
+	{
+		if (NETisReplay())
+		{
+			NETreplayPoppedNetMessage();
+		}
+		else
+		{
+			NETreplaySaveNetMessage(&popped, queue.index);
+		}
+	}
 	receiveQueue(queue)->popMessage();
 }
 
@@ -1523,7 +1523,7 @@ void wzGetWindowResolution(int *screen, unsigned int *width, unsigned int *heigh
 }
 
 // This stage, we handle display mode setting
-bool wzMainScreenSetup(int antialiasing, bool fullscreen, bool vsync, bool highDPI)
+bool wzMainScreenSetup(int antialiasing, bool fullscreen, bool vsync, bool highDPI, bool hidden)
 {
 	// populate with the saved values (if we had any)
 	// NOTE: Prior to wzMainScreenSetup being run, the display system is populated with the window width + height
@@ -1533,6 +1533,16 @@ bool wzMainScreenSetup(int antialiasing, bool fullscreen, bool vsync, bool highD
 	int height = pie_GetVideoBufferHeight();
 	int bitDepth = pie_GetVideoBufferDepth();
 
+#if !defined(WZ_OS_WIN) && !defined(WZ_OS_MAC)
+	if (hidden && SDL_getenv("SDL_VIDEODRIVER") == nullptr && SDL_getenv("DISPLAY") == nullptr && SDL_getenv("WAYLAND_DISPLAY") == nullptr)
+	{
+		// There is no display to open the hidden window on. SDL's offscreen driver (SDL 2.0.12+) creates the
+		// OpenGL context through EGL instead. Without EGL, run under a virtual display, such as Xvfb.
+		debug(LOG_INFO, "No display found, using the offscreen video driver");
+		SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+	}
+#endif
+
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0)
 	{
 		debug(LOG_ERROR, "Error: Could not initialise SDL (%s).", SDL_GetError());
@@ -1692,7 +1702,7 @@ bool wzMainScreenSetup(int antialiasing, bool fullscreen, bool vsync, bool highD
 	}
 
 	//// The flags to pass to SDL_CreateWindow
-	int video_flags  = SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN;
+	int video_flags  = SDL_WINDOW_OPENGL | (hidden ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN);
 
 	if (fullscreen)
 	{
@@ -1786,6 +1796,10 @@ bool wzMainScreenSetup(int antialiasing, bool fullscreen, bool vsync, bool highD
 	if (!WZglcontext)
 	{
 		debug(LOG_ERROR, "Failed to create a openGL context! [%s]", SDL_GetError());
+		if (hidden)
+		{
+			debug(LOG_ERROR, "Running headless still needs OpenGL: a display, a virtual display such as Xvfb, or EGL for SDL_VIDEODRIVER=offscreen.");
+		}
 		return false;
 	}
 
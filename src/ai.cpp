@@ -72,6 +72,9 @@
 #define	WEIGHT_CMD_RANK				(WEIGHT_DIST_TILE * 4)			//A single rank is as important as 4 tiles distance
 #define	WEIGHT_CMD_SAME_TARGET		WEIGHT_DIST_TILE				//Don't want this to be too high, since a commander can have many units assigned
 
+// Objects with no enemies within their range plus aiCalmMargin() don't look for targets until they check again
+#define AI_CALM_UPD_SKIP_FRAMES		500
+
 uint8_t alliances[MAX_PLAYER_SLOTS][MAX_PLAYER_SLOTS];
 
 /// A bitfield of vision sharing in alliances, for quick manipulation of vision information
@@ -136,6 +139,43 @@ static bool aiObjHasRange(BASE_OBJECT *psObj, BASE_OBJECT *psTarget, int weapon_
 	return false;
 }
 
+/* How far an enemy can close in between two calm checks: the fastest propulsion, VTOLs included, flying straight
+ * at the object for AI_CALM_UPD_SKIP_FRAMES. Droids may be moving towards the enemy at the same speed. */
+static int aiCalmMargin(const BASE_OBJECT *psObj)
+{
+	unsigned maxSpeed = 0;
+	for (unsigned i = 0; i < numPropulsionStats; ++i)
+	{
+		maxSpeed = std::max(maxSpeed, asPropulsionStats[i].maxSpeed);
+	}
+	unsigned closingSpeed = psObj->type == OBJ_DROID ? 2 * maxSpeed : maxSpeed;
+	return closingSpeed * AI_CALM_UPD_SKIP_FRAMES / GAME_TICKS_PER_SEC;
+}
+
+/* Whether the object can skip looking for targets. Whether any enemies are within range plus aiCalmMargin()
+ * is checked at most once every AI_CALM_UPD_SKIP_FRAMES, and remembered until the next check. So only objects
+ * near enemies look for targets on every update. Callers may skip calling this for a long time, for example
+ * while a droid moves, so the check time is kept per object rather than derived from the game time. */
+bool aiObjectIsCalm(BASE_OBJECT *psObj, int range)
+{
+	if (gameTime - psObj->aiCalmCheckTime < AI_CALM_UPD_SKIP_FRAMES)
+	{
+		return psObj->flags.test(OBJECT_FLAG_AI_CALM);
+	}
+	psObj->aiCalmCheckTime = gameTime;
+
+	bool calm = true;
+	static GridList gridList;  // static to avoid allocations.
+	gridList = gridStartIterate(psObj->pos.x, psObj->pos.y, range + aiCalmMargin(psObj));
+	for (GridIterator gi = gridList.begin(); calm && gi != gridList.end(); ++gi)
+	{
+		BASE_OBJECT *psCurr = *gi;
+		calm = psCurr->type == OBJ_FEATURE || psCurr->died || aiCheckAlliances(psCurr->player, psObj->player);
+	}
+	psObj->flags.set(OBJECT_FLAG_AI_CALM, calm);
+	return calm;
+}
+
 /* Initialise the AI system */
 bool aiInitialise()
 {
@@ -1167,6 +1207,21 @@ void aiUpdateDroid(DROID *psDroid)
 		}
 	}
 
+	/* Don't look for a target if there are no enemies near, unless frustrated enough to shoot at features */
+	if (lookForTarget && !updateTarget)
+	{
+		int range = 0;
+		for (unsigned i = 0; i < MAX(1, psDroid->numWeaps); ++i)
+		{
+			range = MAX(range, aiDroidRange(psDroid, i));
+		}
+		bool frustrated = psDroid->lastFrustratedTime > 0 && gameTime - psDroid->lastFrustratedTime < FRUSTRATED_TIME;
+		if (aiObjectIsCalm(psDroid, range) && !frustrated)
+		{
+			lookForTarget = false;
+		}
+	}
+
 	/* Null target - see if there is an enemy to attack */
 
 	if (lookForTarget && !updateTarget)
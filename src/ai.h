@@ -73,6 +73,9 @@ bool aiObjectIsProbablyDoomed(BASE_OBJECT *psObject, bool isDirect);
 // Update the expected damage of the object.
 void aiObjectAddExpectedDamage(BASE_OBJECT *psObject, SDWORD damage, bool isDirect);
 
+// Is there nothing but allies and features near enough to the object that it might target them soon?
+bool aiObjectIsCalm(BASE_OBJECT *psObj, int range);
+
 /* See if there is a target in range added int weapon_slot*/
 bool aiChooseTarget(BASE_OBJECT *psObj,
                     BASE_OBJECT **ppsTarget, int weapon_slot, bool bUpdateTarget, TARGET_ORIGIN *targetOrigin);
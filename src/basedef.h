@@ -104,6 +104,7 @@ enum OBJECT_FLAG
 	OBJECT_FLAG_TARGETED,
 	OBJECT_FLAG_DIRTY,
 	OBJECT_FLAG_UNSELECTABLE,
+	OBJECT_FLAG_AI_CALM,        ///< No enemies near at the last aiObjectIsCalm() check.
 	OBJECT_FLAG_COUNT
 };
 
@@ -121,6 +122,7 @@ struct BASE_OBJECT : public SIMPLE_OBJECT
 	UDWORD              lastEmission;               ///< When did it last puff out smoke?
 	WEAPON_SUBCLASS     lastHitWeapon;              ///< The weapon that last hit it
 	UDWORD              timeLastHit;                ///< The time the structure was last attacked
+	UDWORD              aiCalmCheckTime = 0;        ///< When aiObjectIsCalm() last looked for enemies near
 	UDWORD              body;                       ///< Hit points with lame name
 	UDWORD              periodicalDamageStart;                  ///< When the object entered the fire
 	UDWORD              periodicalDamage;                 ///< How much damage has been done since the object entered the fire
@@ -77,6 +77,8 @@ typedef struct _poptContext
 
 /// Enable automatic test games
 static bool wz_autogame = false;
+/// Don't show a window, or draw anything
+static bool wz_headless = false;
 static std::string wz_saveandquit;
 static std::string wz_test;
 
@@ -249,6 +251,9 @@ typedef enum
 	CLI_SKIRMISH,
 	CLI_CONTINUE,
 	CLI_AUTOHOST,
+	CLI_REPLAY,
+	CLI_NETDELAY,
+	CLI_HEADLESS,
 } CLI_OPTIONS;
 
 static const struct poptOption *getOptionsTable()
@@ -286,6 +291,9 @@ static const struct poptOption *getOptionsTable()
 		{ "skirmish", POPT_ARG_STRING, CLI_SKIRMISH,   N_("Start skirmish game with given settings file"), N_("test") },
 		{ "continue", POPT_ARG_NONE, CLI_CONTINUE,   N_("Continue the last saved game"), nullptr },
 		{ "autohost", POPT_ARG_STRING, CLI_AUTOHOST,   N_("Start host game with given settings file"), N_("autohost") },
+		{ "replay", POPT_ARG_STRING, CLI_REPLAY,     N_("Play back a recorded multiplayer game"), N_("replay") },
+		{ "netdelay", POPT_ARG_STRING, CLI_NETDELAY, N_("Delay received network data, for testing"), N_("milliseconds[,jitter]") },
+		{ "headless", POPT_ARG_NONE, CLI_HEADLESS,   N_("Run without showing anything or playing sound, for hosting with --autohost. Still needs OpenGL, through a display, Xvfb or EGL"), nullptr },
 		// Terminating entry
 		{ nullptr, 0, 0,              nullptr,                                    nullptr },
 	};
@@ -642,6 +650,10 @@ bool ParseCommandLine(int argc, const char * const *argv)
 			wz_autogame = true;
 			break;
 
+		case CLI_HEADLESS:
+			wz_headless = true;
+			break;
+
 		case CLI_SAVEANDQUIT:
 			token = poptGetOptArg(poptCon);
 			if (token == nullptr || !strchr(token, '/'))
@@ -670,6 +682,28 @@ bool ParseCommandLine(int argc, const char * const *argv)
 			}
 			wz_test = token;
 			break;
+
+		case CLI_REPLAY:
+			hostlaunch = 4;
+			token = poptGetOptArg(poptCon);
+			if (token == nullptr)
+			{
+				qFatal("Bad replay name");
+			}
+			wz_test = token;
+			break;
+
+		case CLI_NETDELAY:
+			{
+				unsigned delay = 0, jitter = 0;
+				token = poptGetOptArg(poptCon);
+				if (token == nullptr || sscanf(token, "%u,%u", &delay, &jitter) < 1)
+				{
+					qFatal("Bad network delay");
+				}
+				NETsetSimulatedDelay(delay, jitter);
+				break;
+			}
 		};
 	}
 
@@ -681,6 +715,11 @@ bool autogame_enabled()
 	return wz_autogame;
 }
 
+bool headless_enabled()
+{
+	return wz_headless;
+}
+
 const std::string &saveandquit_enabled()
 {
 	return wz_saveandquit;
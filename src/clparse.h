@@ -29,6 +29,7 @@ bool ParseCommandLine(int argc, const char * const *argv);
 bool ParseCommandLineEarly(int argc, const char * const *argv);
 
 bool autogame_enabled();
+bool headless_enabled();
 const std::string &saveandquit_enabled();
 const std::string &wz_skirmish_test();
 
@@ -52,6 +52,7 @@
 #include "multiint.h"
 #include "multiplay.h"
 #include "radar.h"
+#include "replay.h"
 #include "seqdisp.h"
 #include "texture.h"
 #include "warzoneconfig.h"
@@ -160,6 +161,9 @@ bool loadConfig()
 	NETsetMasterserverPort(ini.value("masterserver_port", MASTERSERVERPORT).toInt());
 	NETsetGameserverPort(ini.value("gameserver_port", GAMESERVERPORT).toInt());
 	NETsetJoinPreferenceIPv6(ini.value("prefer_ipv6", true).toBool());
+	NETsetFileTransferWindow(ini.value("fileTransferWindow", NETgetFileTransferWindow()).toUInt());
+	replaySetRecording(ini.value("recordReplays", replayGetRecording()).toBool());
+	replaySetMaxFiles(ini.value("replayCount", replayGetMaxFiles()).toInt());
 	setPublicIPv4LookupService(ini.value("publicIPv4LookupService_Url", WZ_DEFAULT_PUBLIC_IPv4_LOOKUP_SERVICE_URL).toString().toStdString(), ini.value("publicIPv4LookupService_JSONKey", WZ_DEFAULT_PUBLIC_IPv4_LOOKUP_SERVICE_JSONKEY).toString().toStdString());
 	setPublicIPv6LookupService(ini.value("publicIPv6LookupService_Url", WZ_DEFAULT_PUBLIC_IPv6_LOOKUP_SERVICE_URL).toString().toStdString(), ini.value("publicIPv6LookupService_JSONKey", WZ_DEFAULT_PUBLIC_IPv6_LOOKUP_SERVICE_JSONKEY).toString().toStdString());
 	war_SetFMVmode((FMV_MODE)ini.value("FMVmode", FMV_FULLSCREEN).toInt());
@@ -305,6 +309,9 @@ bool saveConfig()
 	ini.setValue("server_name", mpGetServerName());
 	ini.setValue("gameserver_port", NETgetGameserverPort());
 	ini.setValue("prefer_ipv6", NETgetJoinPreferenceIPv6());
+	ini.setValue("fileTransferWindow", NETgetFileTransferWindow());
+	ini.setValue("recordReplays", replayGetRecording());
+	ini.setValue("replayCount", replayGetMaxFiles());
 	ini.setValue("publicIPv4LookupService_Url", getPublicIPv4LookupServiceUrl().c_str());
 	ini.setValue("publicIPv4LookupService_JSONKey", getPublicIPv4LookupServiceJSONKey().c_str());
 	ini.setValue("publicIPv6LookupService_Url", getPublicIPv6LookupServiceUrl().c_str());
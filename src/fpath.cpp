@@ -25,6 +25,7 @@
  */
 
 #include <future>
+#include <list>
 #include <unordered_map>
 
 #include "lib/framework/frame.h"
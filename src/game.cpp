@@ -28,6 +28,7 @@
 #include "lib/framework/math_ext.h"
 #include "lib/framework/wzconfig.h"
 #include "lib/framework/file.h"
+#include "lib/framework/asyncfile.h"
 #include "lib/framework/physfs_ext.h"
 #include "lib/framework/strres.h"
 #include "lib/framework/opengl.h"
@@ -1613,7 +1614,8 @@ static bool gameLoadV7(PHYSFS_file *fileHandle);
 static bool gameLoadV(PHYSFS_file *fileHandle, unsigned int version);
 static bool loadMainFile(const std::string &fileName);
 static bool writeMainFile(const std::string &fileName, SDWORD saveType);
-static bool writeGameFile(const char *fileName, SDWORD saveType);
+static bool prepareGameFile(SAVE_GAME *psSaveGame, SDWORD saveType);
+static bool writeGameFile(const char *fileName, const SAVE_GAME *psSaveGame);
 static bool writeMapFile(const char *fileName);
 
 static bool loadSaveDroidInit(char *pFileData, UDWORD filesize);
@@ -1672,6 +1674,9 @@ so can be called in levLoadData when starting a game from a load save game*/
 // -----------------------------------------------------------------------------------------
 bool loadGameInit(const char *fileName)
 {
+	// The save might still be being written
+	saveGameWaitForBackground();
+
 	if (!gameLoad(fileName))
 	{
 		debug(LOG_ERROR, "Corrupted / unsupported savegame file %s, Unable to load!", fileName);
@@ -1847,6 +1852,8 @@ bool loadGame(const char *pGameToLoad, bool keepObjects, bool freeMem, bool User
 	UWORD           missionScrollMinX = 0, missionScrollMinY = 0,
 	                missionScrollMaxX = 0, missionScrollMaxY = 0;
 
+	saveGameWaitForBackground();
+
 	/* Stop the game clock */
 	gameTimeStop();
 
@@ -2054,6 +2061,10 @@ bool loadGame(const char *pGameToLoad, bool keepObjects, bool freeMem, bool User
 	aFileName[fileExten - 1] = '\0';
 	strcat(aFileName, "/");
 
+	// Read the rest of the save game while the first files are being parsed
+	asyncFileReadAheadDirectory(aFileName);
+	AsyncFileReadAheadGuard readAheadGuard(aFileName);  // don't keep it if loading fails, the save may be overwritten
+
 	//the terrain type WILL only change with Campaign changes (well at the moment!)
 	if (gameType != GTYPE_SCENARIO_EXPAND || UserSaveGame)
 	{
@@ -2634,27 +2645,23 @@ error:
 }
 // -----------------------------------------------------------------------------------------
 
-bool saveGame(const char *aFileName, GAME_TYPE saveType)
+// Writes everything but the .gam file, which is only prepared, and written last so that incomplete saves aren't listed
+static bool saveGameFiles(const char *aFileName, GAME_TYPE saveType, SAVE_GAME *psSaveGame)
 {
 	UDWORD			fileExtension;
 	DROID			*psDroid, *psNext;
 	char			CurrentFileName[PATH_MAX] = {'\0'};
 
-	triggerEvent(TRIGGER_GAME_SAVING);
-
-	ASSERT_OR_RETURN(false, aFileName && strlen(aFileName) > 4, "Bad savegame filename");
 	sstrcpy(CurrentFileName, aFileName);
 	debug(LOG_WZ, "saveGame: %s", CurrentFileName);
 
 	fileExtension = strlen(CurrentFileName) - 3;
-	gameTimeStop();
-	sanityUpdate();
 
-	/* Write the data to the file */
-	if (!writeGameFile(CurrentFileName, saveType))
+	/* Put the data in the .gam file */
+	if (!prepareGameFile(psSaveGame, saveType))
 	{
-		debug(LOG_ERROR, "writeGameFile(\"%s\") failed", CurrentFileName);
-		goto error;
+		debug(LOG_ERROR, "prepareGameFile(\"%s\") failed", CurrentFileName);
+		return false;
 	}
 
 	//remove the file extension
@@ -2918,19 +2925,96 @@ bool saveGame(const char *aFileName, GAME_TYPE saveType)
 		swapMissionPointers();
 	}
 
-	// strip the last filename
-	CurrentFileName[fileExtension - 1] = '\0';
+	return true;
+
+error:
+	return false;
+}
+
+bool saveGame(const char *aFileName, GAME_TYPE saveType)
+{
+	SAVE_GAME gameFile;
+
+	saveGameWaitForBackground();
+	triggerEvent(TRIGGER_GAME_SAVING);
+
+	ASSERT_OR_RETURN(false, aFileName && strlen(aFileName) > 4, "Bad savegame filename");
+	gameTimeStop();
+	sanityUpdate();
+
+	/* Write the data to the files */
+	if (!saveGameFiles(aFileName, saveType, &gameFile) || !writeGameFile(aFileName, &gameFile))
+	{
+		debug(LOG_ERROR, "saveGame: writing \"%s\" failed", aFileName);
+		/* Start the game clock */
+		gameTimeStart();
+		return false;
+	}
 
 	/* Start the game clock */
 	triggerEvent(TRIGGER_GAME_SAVED);
 	gameTimeStart();
 	return true;
+}
+
+// The save game being written in the background, if any
+static wz::thread saveGameThread;
+static bool saveGameThreadStarted = false;
+
+bool saveGameInBackground(const char *aFileName, GAME_TYPE saveType, const std::function<void (bool success)> &onDone)
+{
+	saveGameWaitForBackground();
+	triggerEvent(TRIGGER_GAME_SAVING);
+
+	ASSERT_OR_RETURN(false, aFileName && strlen(aFileName) > 4, "Bad savegame filename");
+	gameTimeStop();
+	sanityUpdate();
+
+	// Take the snapshot: the files are only serialised into memory here
+	auto psSaveGame = std::make_shared<SAVE_GAME>();
+	saveFileBeginDeferred();
+	const bool snapshotTaken = saveGameFiles(aFileName, saveType, psSaveGame.get());
+	auto files = std::make_shared<std::vector<DeferredSaveFile>>(saveFileEndDeferred());
+
+	if (!snapshotTaken)
+	{
+		debug(LOG_ERROR, "saveGameInBackground: saving \"%s\" failed", aFileName);
+		/* Start the game clock */
+		gameTimeStart();
+		return false;
+	}
 
-error:
 	/* Start the game clock */
+	triggerEvent(TRIGGER_GAME_SAVED);
 	gameTimeStart();
 
-	return false;
+	// exit() would destroy saveGameThread while still joinable, which calls std::terminate, so finish the save first.
+	static bool waitAtExit = false;
+	if (!waitAtExit)
+	{
+		atexit(saveGameWaitForBackground);
+		waitAtExit = true;
+	}
+
+	std::string fileName = aFileName;
+	saveGameThread = wz::thread([fileName, psSaveGame, files, onDone]() {
+		const bool success = saveDeferredFiles(*files) && writeGameFile(fileName.c_str(), psSaveGame.get());
+		debug(LOG_WZ, "Wrote %s in the background: %s", fileName.c_str(), success ? "ok" : "failed");
+		wzAsyncExecOnMainThread([onDone, success]() {
+			onDone(success);
+		});
+	});
+	saveGameThreadStarted = true;
+	return true;
+}
+
+void saveGameWaitForBackground()
+{
+	if (saveGameThreadStarted)
+	{
+		saveGameThread.join();
+		saveGameThreadStarted = false;
+	}
 }
 
 // -----------------------------------------------------------------------------------------
@@ -3932,41 +4016,15 @@ static bool writeMainFile(const std::string &fileName, SDWORD saveType)
 	return true;
 }
 
-static bool writeGameFile(const char *fileName, SDWORD saveType)
+static bool prepareGameFile(SAVE_GAME *psSaveGame, SDWORD saveType)
 {
-	GAME_SAVEHEADER fileHeader;
-	SAVE_GAME       saveGame;
-	bool            status;
 	unsigned int    i, j;
 
-	PHYSFS_file *fileHandle = openSaveFile(fileName);
-	if (!fileHandle)
-	{
-		debug(LOG_ERROR, "openSaveFile(\"%s\") failed", fileName);
-		return false;
-	}
-
-	fileHeader.aFileType[0] = 'g';
-	fileHeader.aFileType[1] = 'a';
-	fileHeader.aFileType[2] = 'm';
-	fileHeader.aFileType[3] = 'e';
-
-	fileHeader.version = CURRENT_VERSION_NUM;
-
-	debug(LOG_SAVE, "fileversion is %u, (%s) ", fileHeader.version, fileName);
-
-	if (!serializeSaveGameHeader(fileHandle, &fileHeader))
-	{
-		debug(LOG_ERROR, "could not write header to %s; PHYSFS error: %s", fileName, WZ_PHYSFS_getLastError());
-		PHYSFS_close(fileHandle);
-		return false;
-	}
-
 	ASSERT(saveType == GTYPE_SAVE_START || saveType == GTYPE_SAVE_MIDMISSION, "invalid save type");
-	saveGame.saveKey = getCampaignNumber();
+	psSaveGame->saveKey = getCampaignNumber();
 	if (missionIsOffworld())
 	{
-		saveGame.saveKey |= SAVEKEY_ONMISSION;
+		psSaveGame->saveKey |= SAVEKEY_ONMISSION;
 		saveGameOnMission = true;
 	}
 	else
@@ -3976,142 +4034,174 @@ static bool writeGameFile(const char *fileName, SDWORD saveType)
 
 
 	/* Put the save game data into the buffer */
-	saveGame.gameTime = gameTime;
-	saveGame.missionTime = mission.startTime;
+	psSaveGame->gameTime = gameTime;
+	psSaveGame->missionTime = mission.startTime;
 
 	//put in the scroll data
-	saveGame.ScrollMinX = scrollMinX;
-	saveGame.ScrollMinY = scrollMinY;
-	saveGame.ScrollMaxX = scrollMaxX;
-	saveGame.ScrollMaxY = scrollMaxY;
+	psSaveGame->ScrollMinX = scrollMinX;
+	psSaveGame->ScrollMinY = scrollMinY;
+	psSaveGame->ScrollMaxX = scrollMaxX;
+	psSaveGame->ScrollMaxY = scrollMaxY;
 
-	saveGame.GameType = saveType;
+	psSaveGame->GameType = saveType;
 
 	//save the current level so we can load up the STARTING point of the mission
 	ASSERT_OR_RETURN(false, strlen(aLevelName) < MAX_LEVEL_SIZE, "Unable to save level name - too long (max %d) - %s",
 	                 (int)MAX_LEVEL_SIZE, aLevelName);
-	sstrcpy(saveGame.levelName, aLevelName);
+	sstrcpy(psSaveGame->levelName, aLevelName);
 
 	//save out the players power
 	for (i = 0; i < MAX_PLAYERS; ++i)
 	{
-		saveGame.power[i].currentPower = getPower(i);
+		psSaveGame->power[i].currentPower = getPower(i);
 	}
-	saveGame.power[0].extractedPower = radarPermitted; // hideous hack, don't want to break savegames now...
-	saveGame.power[1].extractedPower = allowDesign; // hideous hack, don't want to break savegames now...
+	psSaveGame->power[0].extractedPower = radarPermitted; // hideous hack, don't want to break savegames now...
+	psSaveGame->power[1].extractedPower = allowDesign; // hideous hack, don't want to break savegames now...
 
 	//camera position
-	disp3d_getView(&(saveGame.currentPlayerPos));
+	disp3d_getView(&(psSaveGame->currentPlayerPos));
 
 	//mission data
-	saveGame.missionOffTime =		mission.time;
-	saveGame.missionETA =			mission.ETA;
-	saveGame.missionCheatTime =		mission.cheatTime;
-	saveGame.missionHomeLZ_X =		mission.homeLZ_X;
-	saveGame.missionHomeLZ_Y =		mission.homeLZ_Y;
-	saveGame.missionPlayerX =		mission.playerX;
-	saveGame.missionPlayerY =		mission.playerY;
-	saveGame.missionScrollMinX = (UWORD)mission.scrollMinX;
-	saveGame.missionScrollMinY = (UWORD)mission.scrollMinY;
-	saveGame.missionScrollMaxX = (UWORD)mission.scrollMaxX;
-	saveGame.missionScrollMaxY = (UWORD)mission.scrollMaxY;
-
-	saveGame.offWorldKeepLists = offWorldKeepLists;
-	saveGame.RubbleTile	= getRubbleTileNum();
-	saveGame.WaterTile	= getWaterTileNum();
+	psSaveGame->missionOffTime =		mission.time;
+	psSaveGame->missionETA =			mission.ETA;
+	psSaveGame->missionCheatTime =		mission.cheatTime;
+	psSaveGame->missionHomeLZ_X =		mission.homeLZ_X;
+	psSaveGame->missionHomeLZ_Y =		mission.homeLZ_Y;
+	psSaveGame->missionPlayerX =		mission.playerX;
+	psSaveGame->missionPlayerY =		mission.playerY;
+	psSaveGame->missionScrollMinX = (UWORD)mission.scrollMinX;
+	psSaveGame->missionScrollMinY = (UWORD)mission.scrollMinY;
+	psSaveGame->missionScrollMaxX = (UWORD)mission.scrollMaxX;
+	psSaveGame->missionScrollMaxY = (UWORD)mission.scrollMaxY;
+
+	psSaveGame->offWorldKeepLists = offWorldKeepLists;
+	psSaveGame->RubbleTile	= getRubbleTileNum();
+	psSaveGame->WaterTile	= getWaterTileNum();
 
 	for (i = 0; i < MAX_PLAYERS; ++i)
 	{
-		saveGame.iTranspEntryTileX[i] = mission.iTranspEntryTileX[i];
-		saveGame.iTranspEntryTileY[i] = mission.iTranspEntryTileY[i];
-		saveGame.iTranspExitTileX[i]  = mission.iTranspExitTileX[i];
-		saveGame.iTranspExitTileY[i]  = mission.iTranspExitTileY[i];
-		saveGame.aDefaultSensor[i]    = aDefaultSensor[i];
-		saveGame.aDefaultECM[i]       = aDefaultECM[i];
-		saveGame.aDefaultRepair[i]    = aDefaultRepair[i];
+		psSaveGame->iTranspEntryTileX[i] = mission.iTranspEntryTileX[i];
+		psSaveGame->iTranspEntryTileY[i] = mission.iTranspEntryTileY[i];
+		psSaveGame->iTranspExitTileX[i]  = mission.iTranspExitTileX[i];
+		psSaveGame->iTranspExitTileY[i]  = mission.iTranspExitTileY[i];
+		psSaveGame->aDefaultSensor[i]    = aDefaultSensor[i];
+		psSaveGame->aDefaultECM[i]       = aDefaultECM[i];
+		psSaveGame->aDefaultRepair[i]    = aDefaultRepair[i];
 	}
 
 	for (i = 0; i < MAX_NOGO_AREAS; ++i)
 	{
 		LANDING_ZONE *psLandingZone = getLandingZone(i);
-		saveGame.sLandingZone[i].x1	= psLandingZone->x1; // in case struct changes
-		saveGame.sLandingZone[i].x2	= psLandingZone->x2;
-		saveGame.sLandingZone[i].y1	= psLandingZone->y1;
-		saveGame.sLandingZone[i].y2	= psLandingZone->y2;
+		psSaveGame->sLandingZone[i].x1	= psLandingZone->x1; // in case struct changes
+		psSaveGame->sLandingZone[i].x2	= psLandingZone->x2;
+		psSaveGame->sLandingZone[i].y1	= psLandingZone->y1;
+		psSaveGame->sLandingZone[i].y2	= psLandingZone->y2;
 	}
 
 	//version 17
-	saveGame.objId = MAX(unsynchObjID * 2, (synchObjID + 3) / 4);
+	psSaveGame->objId = MAX(unsynchObjID * 2, (synchObjID + 3) / 4);
 
 	//version 18
-	memset(saveGame.buildDate, 0, sizeof(saveGame.buildDate));
-	saveGame.oldestVersion = 0;
-	saveGame.validityKey = 0;
+	memset(psSaveGame->buildDate, 0, sizeof(psSaveGame->buildDate));
+	psSaveGame->oldestVersion = 0;
+	psSaveGame->validityKey = 0;
 
 	//version 19
 	for (i = 0; i < MAX_PLAYERS; i++)
 	{
 		for (j = 0; j < MAX_PLAYERS; j++)
 		{
-			saveGame.alliances[i][j] = alliances[i][j];
+			psSaveGame->alliances[i][j] = alliances[i][j];
 		}
 	}
 	for (i = 0; i < MAX_PLAYERS; i++)
 	{
-		saveGame.playerColour[i] = getPlayerColour(i);
+		psSaveGame->playerColour[i] = getPlayerColour(i);
 	}
-	saveGame.radarZoom = (UBYTE)GetRadarZoom();
+	psSaveGame->radarZoom = (UBYTE)GetRadarZoom();
 
 	//version 20
-	saveGame.bDroidsToSafetyFlag = (UBYTE)getDroidsToSafetyFlag();
+	psSaveGame->bDroidsToSafetyFlag = (UBYTE)getDroidsToSafetyFlag();
 
 	//version 24
-	saveGame.reinforceTime = missionGetReinforcementTime();
-	saveGame.bPlayCountDown = (UBYTE)getPlayCountDown();
-	saveGame.bPlayerHasWon = (UBYTE)testPlayerHasWon();
-	saveGame.bPlayerHasLost = (UBYTE)testPlayerHasLost();
+	psSaveGame->reinforceTime = missionGetReinforcementTime();
+	psSaveGame->bPlayCountDown = (UBYTE)getPlayCountDown();
+	psSaveGame->bPlayerHasWon = (UBYTE)testPlayerHasWon();
+	psSaveGame->bPlayerHasLost = (UBYTE)testPlayerHasLost();
 
 	//version 30
-	saveGame.scrGameLevel = 0;
-	saveGame.bExtraFailFlag = 0;
-	saveGame.bExtraVictoryFlag = 0;
-	saveGame.bTrackTransporter = 0;
+	psSaveGame->scrGameLevel = 0;
+	psSaveGame->bExtraFailFlag = 0;
+	psSaveGame->bExtraVictoryFlag = 0;
+	psSaveGame->bTrackTransporter = 0;
 
 	// version 33
-	saveGame.sGame		= game;
-	saveGame.savePlayer	= selectedPlayer;
-	saveGame.multiPlayer = bMultiPlayer;
-	saveGame.sNetPlay	= NetPlay;
-	sstrcpy(saveGame.sPName, getPlayerName(selectedPlayer));
+	psSaveGame->sGame		= game;
+	psSaveGame->savePlayer	= selectedPlayer;
+	psSaveGame->multiPlayer = bMultiPlayer;
+	psSaveGame->sNetPlay	= NetPlay;
+	sstrcpy(psSaveGame->sPName, getPlayerName(selectedPlayer));
 	for (i = 0; i < MAX_PLAYERS; ++i)
 	{
-		saveGame.sPlayerIndex[i] = i;
+		psSaveGame->sPlayerIndex[i] = i;
 	}
 
 	//version 34
 	for (i = 0; i < MAX_PLAYERS; ++i)
 	{
-		sstrcpy(saveGame.sPlayerName[i], getPlayerName(i));
+		sstrcpy(psSaveGame->sPlayerName[i], getPlayerName(i));
 	}
 
 	//version 38
-	sstrcpy(saveGame.modList, getModList().c_str());
+	sstrcpy(psSaveGame->modList, getModList().c_str());
 	// Attempt to see if we have a corrupted game structure in campaigns.
-	if (saveGame.sGame.type == CAMPAIGN)
+	if (psSaveGame->sGame.type == CAMPAIGN)
 	{
 		// player 0 is always a human in campaign games
 		for (int i = 1; i < MAX_PLAYERS; i++)
 		{
-			if (saveGame.sGame.skDiff[i] == UBYTE_MAX)
+			if (psSaveGame->sGame.skDiff[i] == UBYTE_MAX)
 			{
 				ASSERT(!"savegame corruption!", "savegame corruption!");
 				debug(LOG_ERROR, "Savegame corruption detected, trying to salvage.  Please Report this issue @ wz2100.net");
-				debug(LOG_ERROR, "skDiff[i] was %d, level %s / %s, ", (int)saveGame.sGame.skDiff[i], saveGame.levelName, saveGame.sGame.map);
-				saveGame.sGame.skDiff[i] = 0;
+				debug(LOG_ERROR, "skDiff[i] was %d, level %s / %s, ", (int)psSaveGame->sGame.skDiff[i], psSaveGame->levelName, psSaveGame->sGame.map);
+				psSaveGame->sGame.skDiff[i] = 0;
 			}
 		}
 	}
-	status = serializeSaveGameData(fileHandle, &saveGame);
+
+	return true;
+}
+
+static bool writeGameFile(const char *fileName, const SAVE_GAME *psSaveGame)
+{
+	GAME_SAVEHEADER fileHeader;
+	bool            status;
+
+	PHYSFS_file *fileHandle = openSaveFile(fileName);
+	if (!fileHandle)
+	{
+		debug(LOG_ERROR, "openSaveFile(\"%s\") failed", fileName);
+		return false;
+	}
+
+	fileHeader.aFileType[0] = 'g';
+	fileHeader.aFileType[1] = 'a';
+	fileHeader.aFileType[2] = 'm';
+	fileHeader.aFileType[3] = 'e';
+
+	fileHeader.version = CURRENT_VERSION_NUM;
+
+	debug(LOG_SAVE, "fileversion is %u, (%s) ", fileHeader.version, fileName);
+
+	if (!serializeSaveGameHeader(fileHandle, &fileHeader))
+	{
+		debug(LOG_ERROR, "could not write header to %s; PHYSFS error: %s", fileName, WZ_PHYSFS_getLastError());
+		PHYSFS_close(fileHandle);
+		return false;
+	}
+
+	status = serializeSaveGameData(fileHandle, psSaveGame);
 
 	// Close the file
 	PHYSFS_close(fileHandle);
@@ -31,6 +31,8 @@
 
 #include "lib/framework/vector.h"
 
+#include <functional>
+
 /***************************************************************************/
 /*
  *	Global Definitions
@@ -122,6 +124,12 @@ bool loadTerrainTypeMap(char *pFileData, UDWORD filesize);
 
 bool saveGame(const char *aFileName, GAME_TYPE saveType);
 
+/// Like saveGame, but only snapshots the game; the files are written on another thread, and onDone is called on the main thread afterwards.
+bool saveGameInBackground(const char *aFileName, GAME_TYPE saveType, const std::function<void (bool success)> &onDone);
+
+/// Wait until the save game being written in the background, if any, is done. Must be called before touching save files.
+void saveGameWaitForBackground();
+
 // Get the campaign number for loadGameInit game
 UDWORD getCampaign(const char *fileName);
 
@@ -27,6 +27,7 @@
 
 #include <string.h>
 
+#include "lib/framework/asyncfile.h"
 #include "lib/framework/frameresource.h"
 #include "lib/framework/file.h"
 #include "lib/framework/physfs_ext.h"
@@ -47,6 +48,7 @@
 #include "advvis.h"
 #include "atmos.h"
 #include "challenge.h"
+#include "clparse.h"
 #include "cmddroid.h"
 #include "configuration.h"
 #include "console.h"
@@ -90,6 +92,7 @@
 #include "ingameop.h"
 #include "qtscript.h"
 #include "template.h"
+#include "replay.h"
 
 #include <algorithm>
 
@@ -252,6 +255,9 @@ bool rebuildSearchPath(searchPathMode mode, bool force, const char *current_map)
 	if (mode != current_mode || (current_map != nullptr ? current_map : "") != current_current_map || force ||
 	    (use_override_mods && override_mod_list != getModList()))
 	{
+		// PhysFS can't unmount archives with open files
+		asyncFileStopReadAhead();
+
 		if (mode != mod_clean)
 		{
 			rebuildSearchPath(mod_clean, false);
@@ -700,11 +706,13 @@ bool systemInitialise(float horizScaleFactor, float vertScaleFactor)
 		return false;
 	}
 
-	if (!audio_Init(droidAudioTrackStopped, war_GetHRTFMode(), war_getSoundEnabled()))
+	// Not war_setSoundEnabled(false) for --headless, which would save sound as off in the config.
+	bool soundEnabled = war_getSoundEnabled() && !headless_enabled();
+	if (!audio_Init(droidAudioTrackStopped, war_GetHRTFMode(), soundEnabled))
 	{
 		debug(LOG_SOUND, "Continuing without audio");
 	}
-	if (war_getSoundEnabled() && war_GetMusicEnabled())
+	if (soundEnabled && war_GetMusicEnabled())
 	{
 		cdAudio_Open(UserMusicPath);
 	}
@@ -735,6 +743,9 @@ bool systemInitialise(float horizScaleFactor, float vertScaleFactor)
 //
 void systemShutdown()
 {
+	// Let an autosave finish writing
+	saveGameWaitForBackground();
+
 	pie_ShutdownRadar();
 	clearLoadedMods();
 
@@ -1209,6 +1220,10 @@ bool stageThreeInitialise()
 	{
 		multiGameInit();
 		initTemplates();
+		if (!fromSave)
+		{
+			replayStartRecording();
+		}
 	}
 
 	preProcessVisibility();
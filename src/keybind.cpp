@@ -53,6 +53,8 @@
 
 #include "cheat.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netlog.h"
+#include "lib/netplay/netreplay.h"
 #include "multiplay.h"
 #include "multimenu.h"
 #include "atmos.h"
@@ -629,13 +631,38 @@ void	kf_FrameRate()
 	                          frameRate(), loopPieCount, loopPolyCount);
 	if (runningMultiplayer())
 	{
-		CONPRINTF("NETWORK:  Bytes: s-%d r-%d  Uncompressed Bytes: s-%d r-%d  Packets: s-%d r-%d",
+		CONPRINTF("NETWORK:  Bytes: s-%" PRIu64 " r-%" PRIu64 "  Uncompressed Bytes: s-%" PRIu64 " r-%" PRIu64 "  Packets: s-%" PRIu64 " r-%" PRIu64 "  Compression us: s-%" PRIu64 " r-%" PRIu64,
 		                          NETgetStatistic(NetStatisticRawBytes, true),
 		                          NETgetStatistic(NetStatisticRawBytes, false),
 		                          NETgetStatistic(NetStatisticUncompressedBytes, true),
 		                          NETgetStatistic(NetStatisticUncompressedBytes, false),
 		                          NETgetStatistic(NetStatisticPackets, true),
-		                          NETgetStatistic(NetStatisticPackets, false));
+		                          NETgetStatistic(NetStatisticPackets, false),
+		                          NETgetStatistic(NetStatisticCompressionMicroseconds, true),
+		                          NETgetStatistic(NetStatisticCompressionMicroseconds, false));
+		CONPRINTF("NETWORK:  Latency ms: median %u, 95%% %u  Update wait ms: median %u, 95%% %u",
+		                          NETgetHistogramPercentile(NetHistogramLatency, 50),
+		                          NETgetHistogramPercentile(NetHistogramLatency, 95),
+		                          NETgetHistogramPercentile(NetHistogramUpdateWait, 50),
+		                          NETgetHistogramPercentile(NetHistogramUpdateWait, 95));
+
+		// Show which message types use the most bandwidth.
+		std::vector<std::pair<uint32_t, unsigned>> typeBytes;
+		for (unsigned type = 0; type < 256; ++type)
+		{
+			NetPacketStatistics stats = NETgetPacketStatistics(type);
+			if (stats.bytes[0] + stats.bytes[1] != 0)
+			{
+				typeBytes.push_back(std::make_pair(stats.bytes[0] + stats.bytes[1], type));
+			}
+		}
+		std::sort(typeBytes.rbegin(), typeBytes.rend());
+		for (size_t i = 0; i < std::min<size_t>(typeBytes.size(), 3); ++i)
+		{
+			NetPacketStatistics stats = NETgetPacketStatistics(typeBytes[i].second);
+			CONPRINTF("NETWORK:  %s: Bytes: s-%u r-%u  Count: s-%u r-%u  Max queued ms: %u", messageTypeToString(typeBytes[i].second),
+			                          stats.bytes[0], stats.bytes[1], stats.count[0], stats.count[1], stats.queuedMaxMilliseconds);
+		}
 	}
 	gameStats = !gameStats;
 	CONPRINTF("Built: %s %s", getCompileDate(), __TIME__);
@@ -2504,7 +2531,7 @@ static void tryChangeSpeed(Rational newMod, Rational oldMod)
 	}
 
 	// only in debug/cheat mode do we enable all time compression speeds.
-	if (!getDebugMappingStatus() && (newMod >= 2 || newMod <= 0))  // 2 = max officially allowed time compression
+	if (!getDebugMappingStatus() && !NETisReplay() && (newMod >= 2 || newMod <= 0))  // 2 = max officially allowed time compression, but a replay may be fast forwarded
 	{
 		return;
 	}
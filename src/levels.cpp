@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include "lib/framework/frame.h"
+#include "lib/framework/asyncfile.h"
 #include "lib/framework/frameresource.h"
 #include "lib/framework/file.h"
 #include "lib/framework/crc.h"
@@ -604,6 +605,43 @@ static bool levLoadSingleWRF(const char *name)
 	return true;
 }
 
+// start reading the data files of a level in the background, ready for levLoadData
+bool levPrefetch(char const *name)
+{
+	LEVEL_DATASET *psNewLevel = levFindDataSet(name);
+	if (psNewLevel == nullptr)
+	{
+		debug(LOG_WZ, "Not prefetching unknown level %s", name);
+		return false;
+	}
+
+	// same dataset selection as levLoadData
+	if (psNewLevel->psChange != nullptr && psCurrLevel != nullptr)
+	{
+		psNewLevel = psNewLevel->psChange;
+	}
+	std::vector<LEVEL_DATASET *> datasets;
+	if (psNewLevel->psBaseData != nullptr && (psCurrLevel == nullptr || psCurrLevel->psBaseData != psNewLevel->psBaseData))
+	{
+		datasets.push_back(psNewLevel->psBaseData);
+	}
+	datasets.push_back(psNewLevel);
+
+	debug(LOG_WZ, "Prefetching level %s", name);
+	for (LEVEL_DATASET *psDataSet : datasets)
+	{
+		for (int i = 0; i < LEVEL_MAXFILES; i++)
+		{
+			// the scenario file is loaded by startMission, not resLoad
+			if (psDataSet->apDataFiles[i] != nullptr && i != psDataSet->game)
+			{
+				resPrefetch(psDataSet->apDataFiles[i]);
+			}
+		}
+	}
+	return true;
+}
+
 const char *getLevelName()
 {
 	return currentLevelName;
@@ -614,6 +652,7 @@ bool levLoadData(char const *name, Sha256 const *hash, char *pSaveName, GAME_TYP
 {
 	LEVEL_DATASET	*psNewLevel, *psBaseData, *psChangeLevel;
 	bool            bCamChangeSaveGame;
+	AsyncFileReadAheadGuard readAheadGuard;  // free whatever was prefetched for this level but not needed, even if loading fails
 
 	debug(LOG_WZ, "Loading level %s hash %s (%s, type %d)", name, hash == nullptr ? "builtin" : hash->toString().c_str(), pSaveName, (int)saveType);
 	if (saveType == GTYPE_SAVE_START || saveType == GTYPE_SAVE_MIDMISSION)
@@ -1039,7 +1078,7 @@ bool levLoadData(char const *name, Sha256 const *hash, char *pSaveName, GAME_TYP
 	if (autogame_enabled())
 	{
 		gameTimeSetMod(Rational(500));
-		if (hostlaunch != 2) // tests will specify the AI manually
+		if (hostlaunch != 2 && hostlaunch != 4) // tests will specify the AI manually, and replays have the recorded orders
 		{
 			jsAutogameSpecific("multiplay/skirmish/semperfi.js", selectedPlayer);
 		}
@@ -1047,6 +1086,8 @@ bool levLoadData(char const *name, Sha256 const *hash, char *pSaveName, GAME_TYP
 
 	ActivityManager::instance().loadedLevel(psCurrLevel->type, mapNameWithoutTechlevel(getLevelName()));
 
+	asyncFileLogTimings("Level load");
+
 	return true;
 }
 
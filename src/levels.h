@@ -88,6 +88,9 @@ bool levInitialise();
 // load up the data for a level
 bool levLoadData(char const *name, Sha256 const *hash, char *pSaveName, GAME_TYPE saveType);
 
+// read the data files of a level in the background, so a later levLoadData of it is quicker
+bool levPrefetch(char const *name);
+
 // find the level dataset
 LEVEL_DATASET *levFindDataSet(char const *name, Sha256 const *hash = nullptr);
 
@@ -58,6 +58,7 @@
 #include "keybind.h"
 #include "keymap.h"
 #include "qtscript.h"
+#include "notifications.h"
 
 #define totalslots 36			// saves slots
 #define slotsInColumn 12		// # of slots in a column
@@ -89,6 +90,7 @@
 #define SAVEENTRY_EDIT			ID_LOADSAVE + totalslots + totalslots		// save edit box. must be highest value possible I guess. -Q
 #define AUTOSAVE_CAM_DIR "savegames/campaign/auto"
 #define AUTOSAVE_SKI_DIR "savegames/skirmish/auto"
+#define AUTOSAVE_TAG "autosave"
 
 // ////////////////////////////////////////////////////////////////////////////
 static void displayLoadBanner(WIDGET *psWidget, UDWORD xOffset, UDWORD yOffset);
@@ -863,6 +865,7 @@ void autoSave()
 		return;
 	}
 	const char *dir = bMultiPlayer? AUTOSAVE_SKI_DIR : AUTOSAVE_CAM_DIR;
+	saveGameWaitForBackground();  // The previous autosave may still be being written.
 	freeAutoSaveSlot(dir);
 
 	time_t now = time(nullptr);
@@ -873,11 +876,15 @@ void autoSave()
 	std::string withoutTechlevel = mapNameWithoutTechlevel(getLevelName());
 	char savefile[PATH_MAX];
 	snprintf(savefile, sizeof(savefile), "%s/%s_%s.gam", dir, withoutTechlevel.c_str(), savedate);
-	if (saveGame(savefile, GTYPE_SAVE_MIDMISSION))
-	{
-		console("AutoSave %s", savefile);
-	}
-	else
+	std::string saveName = savefile;
+	if (!saveGameInBackground(savefile, GTYPE_SAVE_MIDMISSION, [saveName](bool success) {
+		WZ_Notification notification;
+		notification.contentTitle = success ? _("AutoSave") : _("AutoSave failed");
+		notification.contentText = saveName;
+		notification.duration = success ? GAME_TICKS_PER_SEC * 4 : 0;
+		notification.tag = AUTOSAVE_TAG;
+		addNotification(notification, WZ_Notification_Trigger::Immediate());
+	}))
 	{
 		console("AutoSave %s failed", savefile);
 	}
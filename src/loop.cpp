@@ -79,7 +79,9 @@
 #include "cmddroid.h"
 #include "keybind.h"
 #include "wrappers.h"
+#include "clparse.h"
 #include "random.h"
+#include "replay.h"
 #include "qtscript.h"
 #include "version.h"
 #include "notifications.h"
@@ -309,7 +311,10 @@ static GAMECODE renderLoop()
 				processMouseClickInput();
 			}
 			bRender3DOnly = false;
-			displayWorld();
+			if (!headless_enabled())
+			{
+				displayWorld();
+			}
 		}
 		wzPerfBegin(PERF_GUI, "User interface");
 		/* Display the in game interface */
@@ -318,11 +323,14 @@ static GAMECODE renderLoop()
 
 		if (bMultiPlayer && bDisplayMultiJoiningStatus)
 		{
-			intDisplayMultiJoiningStatus(bDisplayMultiJoiningStatus);
+			if (!headless_enabled())
+			{
+				intDisplayMultiJoiningStatus(bDisplayMultiJoiningStatus);
+			}
 			setWidgetsStatus(false);
 		}
 
-		if (getWidgetsStatus())
+		if (getWidgetsStatus() && !headless_enabled())
 		{
 			intDisplayWidgets();
 		}
@@ -387,7 +395,10 @@ static GAMECODE renderLoop()
 		pie_SetFogStatus(false);
 		clearMode = CLEAR_BLACK;
 	}
-	pie_ScreenFlip(clearMode);//gameloopflip
+	if (!headless_enabled())
+	{
+		pie_ScreenFlip(clearMode);//gameloopflip
+	}
 
 	if (quitting)
 	{
@@ -674,6 +685,8 @@ GAMECODE gameLoop()
 		NETflush();  // Make sure that we aren't waiting too long to send data.
 	}
 
+	replayUpdate();
+
 	unsigned before = wzGetTicks();
 	GAMECODE renderReturn = renderLoop();
 	unsigned after = wzGetTicks();
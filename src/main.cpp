@@ -43,6 +43,9 @@
 #include "lib/framework/input.h"
 #include "lib/framework/physfs_ext.h"
 #include "lib/framework/wzpaths.h"
+#include "lib/framework/strres.h"
+#include "lib/framework/file.h"
+#include "lib/framework/asyncfile.h"
 #include "lib/exceptionhandler/exceptionhandler.h"
 #include "lib/exceptionhandler/dumpinfo.h"
 
@@ -83,6 +86,7 @@
 #include "map.h"
 #include "keybind.h"
 #include "random.h"
+#include "replay.h"
 #include "urlrequest.h"
 #include <time.h>
 #include <LaunchInfo.h>
@@ -138,6 +142,8 @@ static GS_GAMEMODE gameStatus = GS_TITLE_SCREEN;
 // Status of the gameloop
 static GAMECODE gameLoopStatus = GAMECODE_CONTINUE;
 static FOCUS_STATE focusState = FOCUS_IN;
+// How long to sleep each frame when running headless
+static const unsigned headlessFrameMilliseconds = 10;
 
 #if defined(WZ_OS_UNIX)
 static bool ignoredSIGPIPE = false;
@@ -1058,7 +1064,7 @@ void mainLoop()
 
 	wzSetCursor(CURSOR_DEFAULT); // if cursor isn't set by anything in the mainLoop, it should revert to default.
 
-	if (NetPlay.bComms || focusState == FOCUS_IN || !war_GetPauseOnFocusLoss())
+	if (NetPlay.bComms || focusState == FOCUS_IN || !war_GetPauseOnFocusLoss() || headless_enabled())
 	{
 		if (loop_GetVideoStatus())
 		{
@@ -1083,6 +1089,11 @@ void mainLoop()
 #if defined(ENABLE_DISCORD)
 	discordRPCPerFrame();
 #endif
+
+	if (headless_enabled())
+	{
+		wzDelay(headlessFrameMilliseconds);  // Nothing is waiting for vsync, so don't spin.
+	}
 }
 
 bool getUTF8CmdLine(int *const utfargc WZ_DECL_UNUSED, char *** const utfargv WZ_DECL_UNUSED) // explicitely pass by reference
@@ -1318,6 +1329,12 @@ int realmain(int argc, char *argv[])
 
 	PHYSFS_mkdir("autohost");	// autohost games launched with --autohost=game
 
+	PHYSFS_mkdir(REPLAY_DIR);	// recorded multiplayer games, played back with --replay=replay/file
+
+	PHYSFS_mkdir("cache/strres");	// compiled string tables
+	strresSetCacheDir("cache/strres", version_getVersionString());
+	initFileHashCache("cache/filehashes.json");	// hashes of maps and mods
+
 	PHYSFS_mkdir("challenges");	// custom challenges
 
 	PHYSFS_mkdir("logs");		// netplay, mingw crash reports & WZ logs
@@ -1484,7 +1501,7 @@ int realmain(int argc, char *argv[])
 
 	ActivityManager::instance().initialize();
 
-	if (!wzMainScreenSetup(war_getAntialiasing(), war_getFullscreen(), war_GetVsync()))
+	if (!wzMainScreenSetup(war_getAntialiasing(), war_getFullscreen() && !headless_enabled(), war_GetVsync(), true, headless_enabled()))
 	{
 		return EXIT_FAILURE;
 	}
@@ -1572,6 +1589,8 @@ int realmain(int argc, char *argv[])
 #if defined(WZ_CC_MSVC) && defined(DEBUG)
 	debug_MEMSTATS();
 #endif
+	asyncFileLogTimings("Startup");
+
 	debug(LOG_MAIN, "Entering main loop");
 	wzMainEventLoop();
 	ActivityManager::instance().preSystemShutdown();
@@ -1592,7 +1611,7 @@ int realmain(int argc, char *argv[])
 	wzShutdown();
 	urlRequestShutdown();
 	debug(LOG_MAIN, "Completed shutting down Warzone 2100");
-	return EXIT_SUCCESS;
+	return replayExitCode();
 }
 
 /*!
@@ -1532,48 +1532,34 @@ void getTileMaxMin(int x, int y, int *pMax, int *pMin)
 /* This will save out the visibility data */
 bool writeVisibilityData(const char *fileName)
 {
-	unsigned int i;
-	VIS_SAVEHEADER fileHeader;
+	const unsigned planes = (game.maxPlayers + 7) / 8;
+	const uint32_t version = CURRENT_VERSION_NUM;
 
-	PHYSFS_file *fileHandle = openSaveFile(fileName);
-	if (!fileHandle)
+	// Build the whole file first, writing it a byte at a time is slow
+	std::vector<char> data;
+	data.reserve(4 + 4 + mapWidth * mapHeight * planes);
+	data.push_back('v');
+	data.push_back('i');
+	data.push_back('s');
+	data.push_back('d');
+	for (int shift = 24; shift >= 0; shift -= 8)
 	{
-		return false;
-	}
-
-	fileHeader.aFileType[0] = 'v';
-	fileHeader.aFileType[1] = 'i';
-	fileHeader.aFileType[2] = 's';
-	fileHeader.aFileType[3] = 'd';
-
-	fileHeader.version = CURRENT_VERSION_NUM;
-
-	// Write out the current file header
-	if (WZ_PHYSFS_writeBytes(fileHandle, fileHeader.aFileType, sizeof(fileHeader.aFileType)) != sizeof(fileHeader.aFileType)
-	    || !PHYSFS_writeUBE32(fileHandle, fileHeader.version))
-	{
-		debug(LOG_ERROR, "writeVisibilityData: could not write header to %s; PHYSFS error: %s", fileName, WZ_PHYSFS_getLastError());
-		PHYSFS_close(fileHandle);
-		return false;
+		data.push_back(static_cast<char>(version >> shift));  // big-endian, like PHYSFS_writeUBE32
 	}
 
-	int planes = (game.maxPlayers + 7) / 8;
-
 	for (unsigned plane = 0; plane < planes; ++plane)
 	{
-		for (i = 0; i < mapWidth * mapHeight; ++i)
+		for (int i = 0; i < mapWidth * mapHeight; ++i)
 		{
-			if (!PHYSFS_writeUBE8(fileHandle, psMapTiles[i].tileExploredBits >> (plane * 8)))
-			{
-				debug(LOG_ERROR, "writeVisibilityData: could not write to %s; PHYSFS error: %s", fileName, WZ_PHYSFS_getLastError());
-				PHYSFS_close(fileHandle);
-				return false;
-			}
+			data.push_back(static_cast<char>(psMapTiles[i].tileExploredBits >> (plane * 8)));
 		}
 	}
 
-	// Everything is just fine!
-	PHYSFS_close(fileHandle);
+	if (!saveFile(fileName, data.data(), data.size()))
+	{
+		debug(LOG_ERROR, "writeVisibilityData: could not write %s", fileName);
+		return false;
+	}
 	return true;
 }
 
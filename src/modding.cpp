@@ -203,6 +203,7 @@ void clearLoadedMods()
 {
 	loaded_mods.clear();
 	mod_list.clear();
+	mod_hash_list.clear();
 }
 
 std::string const &getModList()
@@ -225,13 +226,18 @@ std::string const &getModList()
 
 std::vector<Sha256> const &getModHashList()
 {
-	if (mod_hash_list.empty())
+	if (mod_hash_list.empty() && !loaded_mods.empty())
 	{
+		// Unchanged mods come from the file hash cache, the rest are hashed in parallel.
+		std::vector<std::string> filenames;
 		for (auto const &mod : loaded_mods)
 		{
-			Sha256 hash = findHashOfFile(mod.filename.c_str());
-			debug(LOG_WZ, "Mod[%s]: %s\n", hash.toString().c_str(), mod.filename.c_str());
-			mod_hash_list.push_back(hash);
+			filenames.push_back(mod.filename);
+		}
+		mod_hash_list = findHashesOfFiles(filenames);
+		for (size_t n = 0; n < loaded_mods.size(); ++n)
+		{
+			debug(LOG_WZ, "Mod[%s]: %s\n", mod_hash_list[n].toString().c_str(), loaded_mods[n].filename.c_str());
 		}
 	}
 	return mod_hash_list;
@@ -239,12 +245,12 @@ std::vector<Sha256> const &getModHashList()
 
 std::string getModFilename(Sha256 const &hash)
 {
-	for (auto const &mod : loaded_mods)
+	std::vector<Sha256> const &hashes = getModHashList();
+	for (size_t n = 0; n < hashes.size(); ++n)
 	{
-		Sha256 foundHash = findHashOfFile(mod.filename.c_str());
-		if (foundHash == hash)
+		if (hashes[n] == hash)
 		{
-			return mod.filename;
+			return loaded_mods[n].filename;
 		}
 	}
 	return {};
@@ -58,6 +58,7 @@
 
 #include "lib/gamelib/gtime.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netreplay.h"
 #include "lib/widget/editbox.h"
 #include "lib/widget/button.h"
 #include "lib/widget/widget.h"
@@ -92,6 +93,7 @@
 #include "modding.h"
 #include "qtscript.h"
 #include "random.h"
+#include "replay.h"
 #include "notifications.h"
 
 #include "multiplay.h"
@@ -411,9 +413,9 @@ void loadMultiScripts()
 	uint32_t oldHash1 = DataHash[DATA_SCRIPT];
 	uint32_t oldHash2 = DataHash[DATA_SCRIPTVAL];
 
-	// Load AI players
+	// Load AI players, unless playing back a replay, which has the recorded AI and scavenger orders instead.
 	resForceBaseDir("multiplay/skirmish/");
-	for (unsigned i = 0; i < game.maxPlayers; i++)
+	for (unsigned i = 0; i < game.maxPlayers && !NETisReplay(); i++)
 	{
 		if (NetPlay.players[i].ai < 0 && i == selectedPlayer)
 		{
@@ -452,7 +454,7 @@ void loadMultiScripts()
 	}
 
 	// Load scavengers
-	if (game.scavengers && myResponsibility(scavengerPlayer()))
+	if (game.scavengers && myResponsibility(scavengerPlayer()) && !NETisReplay())
 	{
 		debug(LOG_SAVE, "Loading scavenger AI for player %d", scavengerPlayer());
 		loadPlayerScript("multiplay/script/scavfact.js", scavengerPlayer(), DIFFICULTY_EASY);
@@ -2451,6 +2453,10 @@ void addPlayerBox(bool players)
 static void SendFireUp()
 {
 	uint32_t randomSeed = rand();  // Pick a random random seed for the synchronised random number generator.
+	if (NETisReplay())
+	{
+		replayGameStarting(&randomSeed);  // Same seed and structure limits as the recorded game.
+	}
 
 	NETbeginEncode(NETbroadcastQueue(), NET_FIREUP);
 	NETuint32_t(&randomSeed);
@@ -3514,12 +3520,16 @@ void WzMultiOptionTitleUI::frontendMultiMessages(bool running)
 				NETbin(hash.bytes, hash.Bytes);
 				NETend();
 
-				debug(LOG_WARNING, "Received file cancel request from player %u, they weren't expecting the file.", queue.index);
+				debug(LOG_WARNING, "Received file cancel request from player %u, they weren't expecting the file or gave up on it.", queue.index);
 				auto &wzFiles = NetPlay.players[queue.index].wzFiles;
 				wzFiles.erase(std::remove_if(wzFiles.begin(), wzFiles.end(), [&](WZFile const &file) { return file.hash == hash; }), wzFiles.end());
 			}
 			break;
 
+		case NET_FILE_RECEIVED:
+			NETrecvFileReceived(queue);
+			break;
+
 		case NET_OPTIONS:					// incoming options file.
 			recvOptions(queue);
 			ingame.localOptionsReceived = true;
@@ -3927,16 +3937,19 @@ TITLECODE WzMultiOptionTitleUI::run()
 		}
 	}
 
-	widgDisplayScreen(psWScreen);									// show the widgets currently running
-
-	if (multiRequestUp)
+	if (!headless_enabled())
 	{
-		widgDisplayScreen(psRScreen);								// show the Requester running
-	}
+		widgDisplayScreen(psWScreen);								// show the widgets currently running
 
-	if (widgGetFromID(psWScreen, MULTIOP_CHATBOX))
-	{
-		displayConsoleMessages();									// draw the chatbox
+		if (multiRequestUp)
+		{
+			widgDisplayScreen(psRScreen);							// show the Requester running
+		}
+
+		if (widgGetFromID(psWScreen, MULTIOP_CHATBOX))
+		{
+			displayConsoleMessages();								// draw the chatbox
+		}
 	}
 
 	if (CancelPressed())
@@ -4107,7 +4120,7 @@ void WzMultiOptionTitleUI::start()
 
 	loadMapPreview(false);
 
-	if (autogame_enabled() || hostlaunch == 3)
+	if (autogame_enabled() || hostlaunch == 3 || hostlaunch == 4)
 	{
 		if (hostlaunch == 3)
 		{
@@ -4126,6 +4139,10 @@ void WzMultiOptionTitleUI::start()
 			// reset flag in case people dropped/quit on join screen
 			NETsetPlayerConnectionStatus(CONNECTIONSTATUS_NORMAL, NET_ALL_PLAYERS);
 		}
+		if (hostlaunch == 4 && replayLoad(wz_skirmish_test().c_str()))
+		{
+			startMultiplayerGame();
+		}
 	}
 }
 
@@ -40,6 +40,7 @@
 #include "lib/widget/widget.h"
 #include "lib/gamelib/gtime.h"
 #include "lib/netplay/netplay.h"
+#include "lib/netplay/netlog.h"
 #include "hci.h"
 #include "configuration.h"			// lobby cfg.
 #include "clparse.h"
@@ -61,6 +62,7 @@
 #include "multirecv.h"
 #include "template.h"
 #include "activity.h"
+#include "replay.h"
 
 // send complete game info set!
 void sendOptions()
@@ -241,19 +243,15 @@ void recvOptions(NETQUEUE queue)
 		}
 		else if (findHashOfFile(filename) != hash)
 		{
-			debug(LOG_INFO, "Overwriting old incomplete or corrupt file %s", filename);
+			debug(LOG_INFO, "Continuing old incomplete or corrupt file %s", filename);
 		}
 		else
 		{
 			return false;  // Have the file already.
 		}
 
-		NetPlay.wzFiles.emplace_back(PHYSFS_openWrite(filename), hash);
-
 		// Request the map/mod from the host
-		NETbeginEncode(NETnetQueue(NET_HOST_ONLY), NET_FILE_REQUESTED);
-		NETbin(hash.bytes, hash.Bytes);
-		NETend();
+		NETrequestFile(hash, filename);
 
 		haveData = false;
 		return true;  // Starting download now.
@@ -461,11 +459,23 @@ bool multiGameInit()
 		openchannels[player] = true;								//open comms to this player.
 	}
 
+	// so the statistics written by dumpNetStatistics() at the end are for this game only, not the lobby or earlier games
+	NETresetStatistics();
+
 	gameInit();
 
 	return true;
 }
 
+// Write the network statistics of the game, for finding out what causes the lag.
+static void dumpNetStatistics()
+{
+	time_t now = time(nullptr);
+	char fileName[PATH_MAX];
+	strftime(fileName, sizeof(fileName), "logs/netstats-%F_%H%M%S.json", localtime(&now));
+	NETdumpStatistics(fileName);
+}
+
 ////////////////////////////////
 // at the end of every game.
 bool multiGameShutdown()
@@ -488,6 +498,12 @@ bool multiGameShutdown()
 	{
 		wzYieldCurrentThread();  // TODO Make a wzDelay() function?
 	}
+	replayStop();
+	if (NetPlay.bComms)
+	{
+		dumpNetStatistics();
+	}
+
 	// close game
 	NETclose();
 	NETremRedirects();
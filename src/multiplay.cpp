@@ -1590,14 +1590,25 @@ bool recvMapFileRequested(NETQUEUE queue)
 
 	Sha256 hash;
 	hash.setZero();
+	uint32_t pos = 0;
 	NETbeginDecode(queue, NET_FILE_REQUESTED);
 	NETbin(hash.bytes, hash.Bytes);
+	NETuint32_t(&pos);  // Where the player's partial copy of the file ends.
 	NETend();
 
 	auto &files = NetPlay.players[player].wzFiles;
-	if (std::any_of(files.begin(), files.end(), [&](WZFile const &file) { return file.hash == hash; }))
+	auto sending = std::find_if(files.begin(), files.end(), [&](WZFile const &file) { return file.hash == hash; });
+	if (sending != files.end())
 	{
-		return true;  // Already sending this file, do nothing.
+		if (pos == 0 && sending->pos != 0)
+		{
+			// Their copy turned out to be bad, start again.
+			debug(LOG_INFO, "Sending file to player %u again from the start.", player);
+			PHYSFS_seek(sending->handle, 0);
+			sending->pos = 0;
+			sending->received = 0;
+		}
+		return true;  // Already sending this file.
 	}
 
 	netPlayersUpdated = true;  // Show download icon on player.
@@ -1643,8 +1654,19 @@ bool recvMapFileRequested(NETQUEUE queue)
 	PHYSFS_sint64 fileSize_64 = PHYSFS_fileLength(pFileHandle);
 	ASSERT_OR_RETURN(false, fileSize_64 <= 0xFFFFFFFF, "File too big!");
 
+	// Resume where they got to last time, if they have part of the file. If their copy is too big, it's corrupt, so send it all.
+	if (pos > fileSize_64 || PHYSFS_seek(pFileHandle, pos) == 0)
+	{
+		PHYSFS_seek(pFileHandle, 0);
+		pos = 0;
+	}
+	else if (pos != 0)
+	{
+		debug(LOG_INFO, "Resuming from byte %u of %u.", pos, (unsigned)fileSize_64);
+	}
+
 	// Schedule file to be sent.
-	files.emplace_back(pFileHandle, hash, (uint32_t)fileSize_64);
+	files.emplace_back(pFileHandle, hash, (uint32_t)fileSize_64, pos);
 
 	return true;
 }
@@ -1675,12 +1697,16 @@ void sendMap()
 		{
 			int done = 0;
 			file_startTime = std::chrono::high_resolution_clock::now();
-			do
+			// Don't get more than the window ahead of what the player has confirmed, so a slow player doesn't fill up our buffers.
+			while (file.handle != nullptr && file.pos - file.received < NETgetFileTransferWindow())
 			{
 				done = NETsendFile(file, i);
 				file_currentDuration = std::chrono::duration_cast<microDuration>(std::chrono::high_resolution_clock::now() - file_startTime);
+				if (done == 100 || file_currentDuration.count() >= maxMicroSecondsPerFile)
+				{
+					break;
+				}
 			}
-			while (done < 100 && (file_currentDuration.count() < maxMicroSecondsPerFile));
 			if (done == 100)
 			{
 				netPlayersUpdated = true;  // Remove download icon from player.
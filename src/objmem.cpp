@@ -58,6 +58,7 @@ FEATURE			*apsFeatureLists[MAX_PLAYERS];		///< Only player zero is valid for fea
 STRUCTURE		*apsExtractorLists[MAX_PLAYERS];
 FEATURE			*apsOilList[1];
 BASE_OBJECT		*apsSensorList[1];			///< List of sensors in the game.
+uint32_t		objListChanges[MAX_PLAYERS];		///< Counts additions and removals, by player.
 
 /*The list of Flag Positions allocated */
 FLAG_POSITION	*apsFlagPosLists[MAX_PLAYERS];
@@ -228,6 +229,7 @@ static inline void addObjectToList(OBJECT *list[], OBJECT *object, int player)
 	// Prepend the object to the top of the list
 	object->psNext = list[player];
 	list[player] = object;
+	++objListChanges[player];
 }
 
 /* Add the object to its list
@@ -253,6 +255,7 @@ static inline void destroyObject(OBJECT *list[], OBJECT *object)
 {
 	ASSERT_OR_RETURN(, object != nullptr, "Invalid pointer");
 	ASSERT(gameTime - deltaGameTime <= gameTime || gameTime == 2, "Expected %u <= %u, bad time", gameTime - deltaGameTime, gameTime);
+	++objListChanges[object->player];
 
 	// If the message to remove is the first one in the list then mark the next one as the first
 	if (list[object->player] == object)
@@ -299,6 +302,7 @@ template <typename OBJECT>
 static inline void removeObjectFromList(OBJECT *list[], OBJECT *object, int player)
 {
 	ASSERT_OR_RETURN(, object != nullptr, "Invalid pointer");
+	++objListChanges[player];
 
 	// If the message to remove is the first one in the list then mark the next one as the first
 	if (list[player] == object)
@@ -357,6 +361,8 @@ static inline void removeObjectFromFuncList(OBJECT *list[], OBJECT *object, int
 template <typename OBJECT>
 static inline void releaseAllObjectsInList(OBJECT *list[])
 {
+	scriptRemoveAllObjects();
+
 	// Iterate through all players' object lists
 	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
 	{
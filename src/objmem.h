@@ -35,6 +35,10 @@ extern STRUCTURE		*apsExtractorLists[MAX_PLAYERS];
 extern BASE_OBJECT		*apsSensorList[1];
 extern FEATURE			*apsOilList[1];
 
+/// Incremented whenever an object is added to or removed from a player's object list, so that anything
+/// which caches the lists can tell when it must look at them again.
+extern uint32_t		objListChanges[MAX_PLAYERS];
+
 /* The list of destroyed objects */
 extern BASE_OBJECT	*psDestroyedObj;
 
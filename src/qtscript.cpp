@@ -63,6 +63,8 @@
 #include <QtScript/QScriptValue>
 #include <QtScript/QScriptValueIterator>
 #include <QtScript/QScriptSyntaxCheckResult>
+#include <QtScript/QScriptEngineAgent>
+#include <QtScript/QScriptContextInfo>
 #include <QtCore/QList>
 #include <QtCore/QQueue>
 #include <QtCore/QString>
@@ -82,6 +84,7 @@
 #include "qtscript.h"
 
 #include "lib/framework/file.h"
+#include "lib/framework/physfs_ext.h"
 #include "lib/gamelib/gtime.h"
 #include "lib/netplay/netplay.h"
 #include "multiplay.h"
@@ -94,8 +97,13 @@
 #include "modding.h"
 #include "version.h"
 
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
 #include <set>
 #include <utility>
+#include <vector>
 
 #include "qtscriptdebug.h"
 #include "qtscriptfuncs.h"
@@ -133,16 +141,48 @@ struct timerNode
 	{
 		return function == t.function && player == t.player;
 	}
-	// implement operator less TODO
 };
 
 #define MAX_US 20000
 #define HALF_MAX_US 10000
 
-/// List of timer events for scripts. Before running them, we sort the list then run as many as we have time for.
-/// In this way, we implement load balancing of events and keep frame rates tidy for users. Since scripts run on the
-/// host, we do not need to worry about each peer simulating the world differently.
-static QList<timerNode> timers;
+/// Timer events for scripts, by timer id. Ids are handed out in increasing order, so iterating gives the order
+/// the timers were added in, which is also the order due timers are run in, so that every peer runs them the same way.
+static std::map<int, timerNode> timers;
+static int nextTimerId = 0;
+
+/// Ids of the timers, ordered by the game time they are next due. Removing a timer only removes it from the
+/// timers map, and its entry here is dropped when it gets to the top.
+static std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> timerQueue;
+
+/// Ids of the timers for each player and function, for removeTimer(), and for each game object, for when the object dies.
+static std::map<std::pair<int, QString>, std::set<int>> timersByFunction;
+static std::multimap<int, int> timersByObject;
+
+/// One-shot timers which have run, removed at the start of the next update.
+static std::vector<int> doneTimers;
+
+/// A call to a function which changes the game state, given by a script on a worker thread, to be carried out on the main thread.
+struct SCRIPT_COMMAND
+{
+	QScriptValue function;
+	QScriptValue thisObject;
+	QScriptValueList args;
+};
+
+/// The timers a script using a worker thread runs in this update, and the commands it gives while running them.
+struct SCRIPT_WORKER
+{
+	int player = 0;
+	int index = 0;  ///< Position in the scripts list, to commit the commands of scripts of the same player in a fixed order.
+	std::vector<std::pair<QString, QScriptValueList>> calls;
+	std::vector<SCRIPT_COMMAND> commands;
+	std::vector<DebugDeferredLine> debugOutput;  ///< Logged while running, including failed asserts, written by the main thread afterwards.
+};
+
+/// The scripts which are running on worker threads. Only changed on the main thread while no worker threads run, so the
+/// workers can look themselves up without locking.
+static std::map<QScriptEngine *, SCRIPT_WORKER> scriptWorkers;
 
 /// Scripting engine (what others call the scripting context, but QtScript's nomenclature is different).
 static QList<QScriptEngine *> scripts;
@@ -179,8 +219,167 @@ typedef QHash<QString, MONITOR_BIN> MONITOR;
 static QHash<QScriptEngine *, MONITOR *> monitors;
 static QHash<QScriptEngine *, QStringList> eventNamespaces; // separate event namespaces for libraries
 
+/// Who a script is and which events it handles, looked up once instead of on every event. Any script code can change
+/// the globals these come from, so they are looked up again after the script has run.
+struct EVENT_CACHE
+{
+	bool valid = false;
+	int running = 0;                ///< Calls into the script in progress, don't trust the cache while it is changing.
+	int player = 0;                 ///< The 'me' global.
+	bool receiveAll = false;        ///< The 'isReceivingAllEvents' global.
+	QHash<QString, bool> handles;   ///< Whether the script has a function for the event, or for any namespaced variant of it.
+};
+static QHash<QScriptEngine *, EVENT_CACHE> eventCaches;
+
+/// Pairs of objects for a batched event, collected during a game tick, for scripts which handle the event once per tick.
+struct EVENT_BATCH
+{
+	std::vector<std::pair<BASE_OBJECT *, BASE_OBJECT *>> pairs;  ///< In the order they happened.
+	std::set<std::pair<BASE_OBJECT *, BASE_OBJECT *>> added;     ///< The same pairs, to drop duplicates.
+
+	void add(BASE_OBJECT *psFirst, BASE_OBJECT *psSecond)
+	{
+		if (added.insert(std::make_pair(psFirst, psSecond)).second)
+		{
+			pairs.push_back(std::make_pair(psFirst, psSecond));
+		}
+	}
+
+	/// Drop the pairs with an object which is about to vanish.
+	void remove(BASE_OBJECT *psObj)
+	{
+		auto gone = [psObj](const std::pair<BASE_OBJECT *, BASE_OBJECT *> &pair) { return pair.first == psObj || pair.second == psObj; };
+		for (auto &pair : pairs)
+		{
+			if (gone(pair))
+			{
+				added.erase(pair);
+			}
+		}
+		pairs.erase(std::remove_if(pairs.begin(), pairs.end(), gone), pairs.end());
+	}
+};
+static QHash<QScriptEngine *, EVENT_BATCH> attackedBatches;
+static QHash<QScriptEngine *, EVENT_BATCH> seenBatches;
+
+/// Time spent in a function while profiling.
+struct PROFILE_BIN
+{
+	int calls = 0;
+	qint64 inclusive = 0;   ///< Nanoseconds in the function, including the functions it called.
+	qint64 exclusive = 0;   ///< Nanoseconds in the function itself.
+	bool native = false;    ///< Whether it is a function of the script API.
+};
+
+/// Measures the time spent in every function of a script, including the script API functions, which the engine calls
+/// it on entering and leaving. Also sums the time spent in each call stack, to make flame graphs from.
+class ScriptProfiler : public QScriptEngineAgent
+{
+public:
+	explicit ScriptProfiler(QScriptEngine *engine) : QScriptEngineAgent(engine) { clock.start(); }
+
+	void functionEntry(qint64 scriptId) override
+	{
+		FRAME frame;
+		frame.name = functionName(scriptId);
+		frame.native = scriptId == -1;
+		frame.stack = stack.isEmpty() ? frame.name : stack.last().stack + ";" + frame.name;
+		frame.start = clock.nsecsElapsed();
+		stack.push_back(frame);
+		++active[frame.name];
+	}
+
+	void functionExit(qint64, const QScriptValue &) override
+	{
+		if (stack.isEmpty())
+		{
+			return;  // Entered before profiling started.
+		}
+		FRAME frame = stack.takeLast();
+		qint64 time = clock.nsecsElapsed() - frame.start;
+		PROFILE_BIN &bin = functions[frame.name];
+		bin.calls++;
+		bin.native = frame.native;
+		if (--active[frame.name] == 0)
+		{
+			bin.inclusive += time;  // Only count the outermost call of a recursive function.
+		}
+		bin.exclusive += time - frame.children;
+		folded[frame.stack] += time - frame.children;
+		if (!stack.isEmpty())
+		{
+			stack.last().children += time;
+		}
+	}
+
+	/// Remember the names of the script API functions, since they don't know them themselves.
+	void addNativeNames()
+	{
+		QScriptValueIterator it(engine()->globalObject());
+		while (it.hasNext())
+		{
+			it.next();
+			if (it.value().isFunction() && internalNamespace.count(it.name()) != 0)
+			{
+				nativeNames.insert(it.value().objectId(), it.name());
+				if (it.value().data().isFunction())
+				{
+					nativeNames.insert(it.value().data().objectId(), it.name());  // Wrapped by useWorkerThread().
+				}
+			}
+		}
+	}
+
+	void clear()
+	{
+		functions.clear();
+		folded.clear();
+	}
+
+	QHash<QString, PROFILE_BIN> functions;
+	QHash<QString, qint64> folded;  ///< Nanoseconds spent in each call stack, with the function names separated by ';'.
+
+private:
+	struct FRAME
+	{
+		QString name;
+		QString stack;
+		bool native = false;
+		qint64 start = 0;
+		qint64 children = 0;
+	};
+
+	QString functionName(qint64 scriptId)
+	{
+		QScriptContext *context = engine()->currentContext();
+		if (scriptId == -1)
+		{
+			return nativeNames.value(context->callee().objectId(), "(native)");
+		}
+		QScriptContextInfo info(context);
+		if (!info.functionName().isEmpty())
+		{
+			return info.functionName();
+		}
+		return info.functionType() == QScriptContextInfo::ScriptFunction ? "(anonymous):" + QString::number(info.functionStartLineNumber()) : "(program)";
+	}
+
+	QElapsedTimer clock;
+	QList<FRAME> stack;
+	QHash<QString, int> active;
+	QHash<qint64, QString> nativeNames;
+};
+
+/// The globals of each script as last saved or loaded, so that globals which haven't changed needn't be converted again.
+static QHash<QScriptEngine *, std::map<QString, nlohmann::json>> savedGlobals;
+
+/// Profilers of the scripts, which the engines own. Kept when profiling stops, so that the results can still be shown.
+static QHash<QScriptEngine *, ScriptProfiler *> profilers;
+static bool scriptProfiling = false;
+
 static MODELMAP models;
 static QStandardItemModel *triggerModel;
+static QStandardItemModel *profileModel;
 static bool globalDialog = false;
 
 static void updateGlobalModels();
@@ -196,13 +395,65 @@ void doNotSaveGlobal(const QString &global)
 	internalNamespace.insert(global);
 }
 
+static EVENT_CACHE &eventCache(QScriptEngine *engine)
+{
+	EVENT_CACHE &cache = eventCaches[engine];
+	if (!cache.valid || cache.running > 0)
+	{
+		cache.player = engine->globalObject().property("me").toInt32();
+		cache.receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
+		cache.handles.clear();
+		cache.valid = true;
+	}
+	return cache;
+}
+
+static void invalidateEventCache(QScriptEngine *engine)
+{
+	eventCaches[engine].valid = false;
+}
+
+static int scriptPlayer(QScriptEngine *engine)
+{
+	return eventCache(engine).player;
+}
+
+static bool scriptReceivesAllEvents(QScriptEngine *engine)
+{
+	return eventCache(engine).receiveAll;
+}
+
+// Whether calling the event would do anything, so the arguments needn't be converted if not.
+static bool scriptHandlesEvent(QScriptEngine *engine, const QString &event)
+{
+	EVENT_CACHE &cache = eventCache(engine);
+	QHash<QString, bool>::iterator it = cache.handles.find(event);
+	if (it == cache.handles.end())
+	{
+		QScriptValue value = engine->globalObject().property(event);
+		bool handles = value.isValid() && value.isFunction();
+		for (const QString &s : eventNamespaces.value(engine))
+		{
+			value = engine->globalObject().property(s + event);
+			handles = handles || (value.isValid() && value.isFunction());
+		}
+		it = cache.handles.insert(event, handles);
+	}
+	return it.value();
+}
+
 // Call a function by name
 static QScriptValue callFunction(QScriptEngine *engine, const QString &function, const QScriptValueList &args, bool event = true)
 {
+	if (event && !scriptHandlesEvent(engine, function))
+	{
+		debug(LOG_SCRIPT, "called function (%s) not defined", function.toUtf8().constData());
+		return false;
+	}
 	if (event)
 	{
 		// recurse into variants, if any
-		for (const QString &s : eventNamespaces[engine])
+		for (const QString &s : eventNamespaces.value(engine))
 		{
 			const QScriptValue &value = engine->globalObject().property(s + function);
 			if (value.isValid() && value.isFunction())
@@ -222,7 +473,10 @@ static QScriptValue callFunction(QScriptEngine *engine, const QString &function,
 	}
 	QElapsedTimer timer;
 	timer.start();
+	++eventCaches[engine].running;
 	QScriptValue result = value.call(QScriptValue(), args);
+	--eventCaches[engine].running;
+	invalidateEventCache(engine);
 	int ticks = timer.nsecsElapsed() / 1000;
 	MONITOR *monitor = monitors.value(engine); // pick right one for this engine
 	MONITOR_BIN m;
@@ -263,6 +517,53 @@ static QScriptValue callFunction(QScriptEngine *engine, const QString &function,
 	return result;
 }
 
+static void addTimer(const timerNode &node)
+{
+	int id = nextTimerId++;
+	timers[id] = node;
+	timerQueue.push(std::make_pair(node.frameTime, id));
+	timersByFunction[std::make_pair(node.player, node.function)].insert(id);
+	if (node.baseobj >= 0)
+	{
+		timersByObject.insert(std::make_pair(node.baseobj, id));
+	}
+}
+
+static void removeTimer(int id)
+{
+	auto it = timers.find(id);
+	if (it == timers.end())
+	{
+		return;
+	}
+	const timerNode &node = it->second;
+	auto fn = timersByFunction.find(std::make_pair(node.player, node.function));
+	fn->second.erase(id);
+	if (fn->second.empty())
+	{
+		timersByFunction.erase(fn);
+	}
+	auto objs = timersByObject.equal_range(node.baseobj);
+	for (auto obj = objs.first; obj != objs.second; ++obj)
+	{
+		if (obj->second == id)
+		{
+			timersByObject.erase(obj);
+			break;
+		}
+	}
+	timers.erase(it);
+}
+
+static void clearTimers()
+{
+	timers.clear();
+	timerQueue = decltype(timerQueue)();
+	timersByFunction.clear();
+	timersByObject.clear();
+	doneTimers.clear();
+}
+
 //-- ## setTimer(function, milliseconds[, object])
 //--
 //-- Set a function to run repeated at some given time interval. The function to run
@@ -305,7 +606,7 @@ static QScriptValue js_setTimer(QScriptContext *context, QScriptEngine *engine)
 		}
 	}
 	node.type = TIMER_REPEAT;
-	timers.push_back(node);
+	addTimer(node);
 	return QScriptValue();
 }
 
@@ -319,17 +620,12 @@ static QScriptValue js_removeTimer(QScriptContext *context, QScriptEngine *engin
 	SCRIPT_ASSERT(context, context->argument(0).isString(), "Timer functions must be quoted");
 	QString function = context->argument(0).toString();
 	int player = engine->globalObject().property("me").toInt32();
-	int i, size = timers.size();
-	for (i = 0; i < size; ++i)
+	auto fn = timersByFunction.find(std::make_pair(player, function));
+	if (fn != timersByFunction.end())
 	{
-		timerNode node = timers.at(i);
-		if (node.function == function && node.player == player)
-		{
-			timers.removeAt(i);
-			break;
-		}
+		removeTimer(*fn->second.begin());  // The oldest, like the first in the list used to be.
 	}
-	if (i == size)
+	else
 	{
 		// Friendly warning
 		QString warnName = function.left(15) + "...";
@@ -379,7 +675,7 @@ static QScriptValue js_queue(QScriptContext *context, QScriptEngine *engine)
 		}
 	}
 	node.type = TIMER_ONESHOT_READY;
-	timers.push_back(node);
+	addTimer(node);
 	return QScriptValue();
 }
 
@@ -403,22 +699,34 @@ static QScriptValue js_profile(QScriptContext *context, QScriptEngine *engine)
 
 void scriptRemoveObject(BASE_OBJECT *psObj)
 {
+	for (auto &batch : attackedBatches)
+	{
+		batch.remove(psObj);
+	}
+	for (auto &batch : seenBatches)
+	{
+		batch.remove(psObj);
+	}
 	// Weed out timers with dead objects
-	for (int i = 0; i < timers.count();)
+	auto objs = timersByObject.equal_range(psObj->id);
+	std::vector<int> ids;
+	for (auto obj = objs.first; obj != objs.second; ++obj)
 	{
-		const timerNode node = timers.at(i);
-		if (node.baseobj == psObj->id)
-		{
-			timers.removeAt(i);
-		}
-		else
-		{
-			i++;
-		}
+		ids.push_back(obj->second);
+	}
+	for (int id : ids)
+	{
+		removeTimer(id);
 	}
 	groupRemoveObject(psObj);
 }
 
+void scriptRemoveAllObjects()
+{
+	attackedBatches.clear();
+	seenBatches.clear();
+}
+
 //-- ## namespace(prefix)
 //-- Registers a new event namespace. All events can now have this prefix. This is useful for
 //-- code libraries, to implement event that do not conflict with events in main code. This
@@ -429,6 +737,7 @@ static QScriptValue js_namespace(QScriptContext *context, QScriptEngine *engine)
 {
 	QString prefix(context->argument(0).toString());
 	eventNamespaces[engine].append(prefix);
+	invalidateEventCache(engine);
 	return QScriptValue(true);
 }
 
@@ -481,6 +790,199 @@ static QScriptValue js_include(QScriptContext *context, QScriptEngine *engine)
 	return QScriptValue(true);
 }
 
+/// Functions which only read the game state, and are safe to call from a worker thread while the main thread waits.
+static const std::set<QString> workerSafeFunctions =
+{
+	"allianceExistsBetween", "componentAvailable", "countDroid", "countStruct", "distBetweenTwoPoints",
+	"enumDroidSnapshot", "enumStructSnapshot", "getMissionTime", "getMultiTechLevel", "isStructureAvailable",
+	"playerPower", "profile", "structureIdle",
+};
+
+static QScriptValue js_workerCommand(QScriptContext *context, QScriptEngine *engine)
+{
+	QScriptValue function = context->callee().data();
+	QScriptValueList args;
+	for (int i = 0; i < context->argumentCount(); ++i)
+	{
+		args.push_back(context->argument(i));
+	}
+	auto worker = scriptWorkers.find(engine);
+	if (worker == scriptWorkers.end())
+	{
+		return function.call(context->thisObject(), args);  // Not on a worker thread, so just do it.
+	}
+	worker->second.commands.push_back(SCRIPT_COMMAND{function, context->thisObject(), args});
+	return QScriptValue();
+}
+
+/// Replace the functions which change the game state with ones which queue the call when on a worker thread, or put them back.
+static void wrapWorkerCommands(QScriptEngine *engine, bool wrap)
+{
+	QScriptValueIterator it(engine->globalObject());
+	while (it.hasNext())
+	{
+		it.next();
+		if (!it.value().isFunction() || (it.flags() & QScriptValue::SkipInEnumeration)
+		    || internalNamespace.count(it.name()) == 0 || workerSafeFunctions.count(it.name()) != 0)
+		{
+			continue;  // Not an API function, or a safe one.
+		}
+		if (wrap)
+		{
+			QScriptValue wrapper = engine->newFunction(js_workerCommand);
+			wrapper.setData(it.value());
+			it.setValue(wrapper);
+		}
+		else if (it.value().data().isFunction())
+		{
+			it.setValue(it.value().data());
+		}
+	}
+}
+
+//-- ## useWorkerThread(bool)
+//-- Run the timers of this script on a worker thread, at the same time as the timers of other scripts
+//-- doing the same. While on the worker thread, only a few functions which read the game state return
+//-- their results, namely ```enumDroidSnapshot()```, ```enumStructSnapshot()```, ```countDroid()```,
+//-- ```countStruct()```, ```playerPower()```, ```structureIdle()```, ```componentAvailable()```,
+//-- ```isStructureAvailable()```, ```allianceExistsBetween()```, ```distBetweenTwoPoints()```,
+//-- ```getMissionTime()```, ```getMultiTechLevel()``` and ```profile()```. Calls to any other function
+//-- return nothing, and are carried out after the timers have run, in player order. Events still run
+//-- on the main thread. Returns whether the script uses a worker thread. (3.4+ only)
+//--
+static QScriptValue js_useWorkerThread(QScriptContext *context, QScriptEngine *engine)
+{
+	if (context->argumentCount() > 0)
+	{
+		bool value = context->argument(0).toBool();
+		if (value != engine->globalObject().property("isUsingWorkerThread").toBool())
+		{
+			wrapWorkerCommands(engine, value);
+			engine->globalObject().setProperty("isUsingWorkerThread", value, QScriptValue::ReadOnly | QScriptValue::Undeletable);
+		}
+	}
+	return engine->globalObject().property("isUsingWorkerThread");
+}
+
+/// Run the timers of the scripts using worker threads, then carry out the commands they gave, in player order.
+static void runScriptWorkers()
+{
+	if (scriptWorkers.empty())
+	{
+		return;
+	}
+	std::vector<wz::thread> threads;
+	for (auto &it : scriptWorkers)
+	{
+		QScriptEngine *engine = it.first;
+		SCRIPT_WORKER *worker = &it.second;
+		threads.emplace_back([engine, worker]() {
+			debugDeferOutput(&worker->debugOutput);
+			for (const auto &call : worker->calls)
+			{
+				callFunction(engine, call.first, call.second, true);
+			}
+			debugDeferOutput(nullptr);
+		});
+	}
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	std::vector<std::pair<QScriptEngine *, SCRIPT_WORKER>> workers(scriptWorkers.begin(), scriptWorkers.end());
+	scriptWorkers.clear();
+	std::sort(workers.begin(), workers.end(), [](std::pair<QScriptEngine *, SCRIPT_WORKER> const &a, std::pair<QScriptEngine *, SCRIPT_WORKER> const &b) {
+		return a.second.player != b.second.player ? a.second.player < b.second.player : a.second.index < b.second.index;
+	});
+	for (auto &it : workers)
+	{
+		QScriptEngine *engine = it.first;
+		debugWriteDeferred(it.second.debugOutput);
+		for (SCRIPT_COMMAND &command : it.second.commands)
+		{
+			QScriptValue result = command.function.call(command.thisObject, command.args);
+			if (engine->hasUncaughtException())
+			{
+				debug(LOG_ERROR, "Uncaught exception at line %d, in a command from a worker thread: %s",
+				      engine->uncaughtExceptionLineNumber(), result.toString().toUtf8().constData());
+				engine->clearExceptions();
+			}
+		}
+		invalidateEventCache(engine);
+	}
+}
+
+static void startProfiling(QScriptEngine *engine)
+{
+	ScriptProfiler *profiler = profilers.value(engine);
+	if (profiler == nullptr)
+	{
+		profiler = new ScriptProfiler(engine);
+		profilers.insert(engine, profiler);
+	}
+	profiler->clear();
+	profiler->addNativeNames();
+	engine->setAgent(profiler);
+}
+
+/// Write the time spent in each call stack to logs/<script>.<player>.folded, in microseconds, for flamegraph.pl and similar tools.
+static void stopProfiling(QScriptEngine *engine)
+{
+	ScriptProfiler *profiler = profilers.value(engine);
+	if (profiler == nullptr || engine->agent() != profiler)
+	{
+		return;
+	}
+	engine->setAgent(nullptr);
+	QString scriptName = engine->globalObject().property("scriptName").toString();
+	int me = engine->globalObject().property("me").toInt32();
+	std::string path = QString("logs/" + scriptName + "." + QString::number(me) + ".folded").toStdString();
+	std::string data;
+	for (auto it = profiler->folded.constBegin(); it != profiler->folded.constEnd(); ++it)
+	{
+		data += it.key().toStdString() + " " + std::to_string(it.value() / 1000) + "\n";
+	}
+	PHYSFS_file *fileHandle = PHYSFS_openWrite(path.c_str());
+	if (fileHandle == nullptr)
+	{
+		debug(LOG_ERROR, "Could not create script profile %s: %s", path.c_str(), WZ_PHYSFS_getLastError());
+		return;
+	}
+	bool written = WZ_PHYSFS_writeBytes(fileHandle, data.data(), data.size()) == static_cast<PHYSFS_sint64>(data.size());
+	if (!PHYSFS_close(fileHandle) || !written)
+	{
+		debug(LOG_ERROR, "Could not write script profile %s: %s", path.c_str(), WZ_PHYSFS_getLastError());
+		return;
+	}
+	debug(LOG_INFO, "Wrote script profile %s", path.c_str());
+}
+
+void jsSetProfiling(bool enable)
+{
+	if (enable == scriptProfiling)
+	{
+		return;
+	}
+	scriptProfiling = enable;
+	for (auto *engine : scripts)
+	{
+		if (enable)
+		{
+			startProfiling(engine);
+		}
+		else
+		{
+			stopProfiling(engine);
+		}
+	}
+}
+
+bool jsIsProfiling()
+{
+	return scriptProfiling;
+}
+
 // do not want to call this 'init', since scripts are often loaded before we get here
 bool prepareScripts(bool loadGame)
 {
@@ -511,6 +1013,9 @@ bool shutdownScripts()
 	globalDialog = false;
 	models.clear();
 	triggerModel = nullptr;
+	profileModel = nullptr;
+	jsSetProfiling(false);
+	profilers.clear();  // Deleted with their engines.
 	for (auto *engine : scripts)
 	{
 		MONITOR *monitor = monitors.value(engine);
@@ -532,9 +1037,13 @@ bool shutdownScripts()
 		delete monitor;
 		unregisterFunctions(engine);
 	}
-	timers.clear();
+	clearTimers();
 	internalNamespace.clear();
 	monitors.clear();
+	eventCaches.clear();
+	attackedBatches.clear();
+	seenBatches.clear();
+	savedGlobals.clear();
 	while (!scripts.isEmpty())
 	{
 		delete scripts.takeFirst();
@@ -542,6 +1051,33 @@ bool shutdownScripts()
 	return true;
 }
 
+/// Call the batched event of each script with the pairs collected for it since the last call, as a list of [first, second] lists.
+static void runEventBatches(QHash<QScriptEngine *, EVENT_BATCH> &batches, const QString &event)
+{
+	for (auto *engine : scripts)
+	{
+		auto it = batches.find(engine);
+		if (it == batches.end() || it->pairs.empty())
+		{
+			continue;
+		}
+		std::vector<std::pair<BASE_OBJECT *, BASE_OBJECT *>> pairs;
+		pairs.swap(it->pairs);
+		it->added.clear();
+		QScriptValue list = engine->newArray(pairs.size());
+		for (size_t i = 0; i < pairs.size(); ++i)
+		{
+			QScriptValue pair = engine->newArray(2);
+			pair.setProperty(0, convMax(pairs[i].first, engine));
+			pair.setProperty(1, convMax(pairs[i].second, engine));
+			list.setProperty(i, pair);
+		}
+		QScriptValueList args;
+		args += list;
+		callFunction(engine, event, args);
+	}
+}
+
 bool updateScripts()
 {
 	// Call delayed triggers here
@@ -561,48 +1097,86 @@ bool updateScripts()
 	{
 		engine->globalObject().setProperty("gameTime", gameTime, QScriptValue::ReadOnly | QScriptValue::Undeletable);
 	}
+	// Deliver the batched events of the last game tick
+	runEventBatches(attackedBatches, "eventAttackedBatch");
+	runEventBatches(seenBatches, "eventObjectSeenBatch");
 	// Weed out dead timers
-	for (int i = 0; i < timers.count();)
+	for (int id : doneTimers)
+	{
+		removeTimer(id);
+	}
+	doneTimers.clear();
+	// Check for timers, and run them if applicable.
+	// TODO - load balancing
+	std::map<int, timerNode> runlist; // make a new list here, since we might trample all over the timers during execution
+	while (!timerQueue.empty() && timerQueue.top().first <= (int)gameTime)
 	{
-		const timerNode node = timers.at(i);
-		if (node.type == TIMER_ONESHOT_DONE)
+		int id = timerQueue.top().second;
+		timerQueue.pop();
+		auto it = timers.find(id);
+		if (it == timers.end())
 		{
-			timers.removeAt(i);
+			continue;  // Removed since it was queued.
 		}
-		else
+		timerNode &node = it->second;
+		node.frameTime = node.ms + gameTime;	// update for next invokation
+		if (node.type == TIMER_ONESHOT_READY)
 		{
-			i++;
+			node.type = TIMER_ONESHOT_DONE; // unless there is none
+			doneTimers.push_back(id);
 		}
+		node.calls++;
+		runlist[id] = node;
 	}
-	// Check for timers, and run them if applicable.
-	// TODO - load balancing
-	QList<timerNode> runlist; // make a new list here, since we might trample all over the timer list during execution
-	QList<timerNode>::iterator iter;
-	for (iter = timers.begin(); iter != timers.end(); iter++)
+	// Queue the repeating timers again only now, so a timer with an interval of 0 doesn't run more than once.
+	for (const auto &run : runlist)
 	{
-		if (iter->frameTime <= gameTime)
+		if (run.second.type == TIMER_REPEAT)
 		{
-			iter->frameTime = iter->ms + gameTime;	// update for next invokation
-			if (iter->type == TIMER_ONESHOT_READY)
-			{
-				iter->type = TIMER_ONESHOT_DONE; // unless there is none
-			}
-			iter->calls++;
-			runlist.append(*iter);
+			timerQueue.push(std::make_pair(run.second.frameTime, run.first));
 		}
 	}
-	for (iter = runlist.begin(); iter != runlist.end(); iter++)
+	// Run in the order the timers were added, not the order they were due. The timers of scripts using
+	// worker threads run first, with their arguments looked up now, since the game state won't change.
+	for (const auto &run : runlist)
 	{
+		const timerNode &node = run.second;
+		if (!node.engine->globalObject().property("isUsingWorkerThread").toBool())
+		{
+			continue;
+		}
 		QScriptValueList args;
-		if (iter->baseobj > 0)
+		if (node.baseobj > 0)
 		{
-			args += convMax(IdToObject(iter->baseobjtype, iter->baseobj, iter->player), iter->engine);
+			args += convMax(IdToObject(node.baseobjtype, node.baseobj, node.player), node.engine);
 		}
-		else if (!iter->stringarg.isEmpty())
+		else if (!node.stringarg.isEmpty())
 		{
-			args += iter->stringarg;
+			args += node.stringarg;
 		}
-		callFunction(iter->engine, iter->function, args, true);
+		SCRIPT_WORKER &worker = scriptWorkers[node.engine];
+		worker.player = scriptPlayer(node.engine);
+		worker.index = scripts.indexOf(node.engine);
+		worker.calls.push_back(std::make_pair(node.function, args));
+	}
+	runScriptWorkers();
+	for (const auto &run : runlist)
+	{
+		const timerNode &node = run.second;
+		if (node.engine->globalObject().property("isUsingWorkerThread").toBool())
+		{
+			continue;
+		}
+		QScriptValueList args;
+		if (node.baseobj > 0)
+		{
+			args += convMax(IdToObject(node.baseobjtype, node.baseobj, node.player), node.engine);
+		}
+		else if (!node.stringarg.isEmpty())
+		{
+			args += node.stringarg;
+		}
+		callFunction(node.engine, node.function, args, true);
 	}
 
 	if (globalDialog && doUpdateModels)
@@ -640,6 +1214,7 @@ QScriptEngine *loadPlayerScript(const WzString& path, int player, int difficulty
 	engine->globalObject().setProperty("profile", engine->newFunction(js_profile));
 	engine->globalObject().setProperty("include", engine->newFunction(js_include));
 	engine->globalObject().setProperty("namespace", engine->newFunction(js_namespace));
+	engine->globalObject().setProperty("useWorkerThread", engine->newFunction(js_useWorkerThread));
 
 	// Special global variables
 	//== * ```version``` Current version of the game, set in *major.minor* format.
@@ -699,6 +1274,7 @@ QScriptEngine *loadPlayerScript(const WzString& path, int player, int difficulty
 	engine->globalObject().setProperty("isMultiplayer", NetPlay.bComms, QScriptValue::ReadOnly | QScriptValue::Undeletable);
 	// un-documented placeholder variable
 	engine->globalObject().setProperty("isReceivingAllEvents", false, QScriptValue::ReadOnly | QScriptValue::Undeletable);
+	engine->globalObject().setProperty("isUsingWorkerThread", false, QScriptValue::ReadOnly | QScriptValue::Undeletable);
 
 	// Regular functions
 	QFileInfo basename(QString::fromUtf8(path.toUtf8().c_str()));
@@ -724,12 +1300,19 @@ QScriptEngine *loadPlayerScript(const WzString& path, int player, int difficulty
 	//== * ```scriptPath``` Base path of the script that is running.
 	engine->globalObject().setProperty("scriptPath", basename.path(), QScriptValue::ReadOnly | QScriptValue::Undeletable);
 
+	++eventCaches[engine].running;
 	QScriptValue result = engine->evaluate(source, QString::fromUtf8(path.toUtf8().c_str()));
+	--eventCaches[engine].running;
+	invalidateEventCache(engine);
 	ASSERT_OR_RETURN(nullptr, !engine->hasUncaughtException(), "Uncaught exception at line %d, file %s: %s",
 	                 engine->uncaughtExceptionLineNumber(), path.toUtf8().c_str(), result.toString().toUtf8().constData());
 
 	// Register script
 	scripts.push_back(engine);
+	if (scriptProfiling)
+	{
+		startProfiling(engine);
+	}
 
 	MONITOR *monitor = new MONITOR;
 	monitors.insert(engine, monitor);
@@ -743,6 +1326,65 @@ bool loadGlobalScript(WzString path)
 	return loadPlayerScript(std::move(path), selectedPlayer, 0);
 }
 
+/// Whether converting the value to JSON would give the given JSON. Only handles the plain values, arrays and objects that
+/// scripts usually keep in their globals, anything else is never equal, and gets converted.
+static bool scriptValueEqualsJson(const QScriptValue &value, const nlohmann::json &instance)
+{
+	if (value.isUndefined() || value.isNull())
+	{
+		return instance.is_null();
+	}
+	if (value.isBool())
+	{
+		return instance.is_boolean() && instance.get<bool>() == value.toBool();
+	}
+	if (value.isNumber())
+	{
+		return instance.is_number() && instance.get<double>() == value.toNumber();
+	}
+	if (value.isString())
+	{
+		return instance.is_string() && instance.get_ref<const std::string &>() == value.toString().toUtf8().constData();
+	}
+	if (value.isArray())
+	{
+		uint32_t length = value.property("length").toUInt32();
+		if (!instance.is_array() || instance.size() != length)
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < length; ++i)
+		{
+			if (!scriptValueEqualsJson(value.property(i), instance[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	if (value.isObject() && !value.isFunction() && !value.isDate() && !value.isRegExp() && !value.isQObject() && !value.isVariant())
+	{
+		if (!instance.is_object())
+		{
+			return false;
+		}
+		size_t count = 0;
+		QScriptValueIterator it(value);
+		while (it.hasNext())
+		{
+			it.next();
+			auto member = instance.find(it.name().toUtf8().constData());
+			if (member == instance.end() || !scriptValueEqualsJson(it.value(), *member))
+			{
+				return false;
+			}
+			++count;
+		}
+		return count == instance.size();
+	}
+	return false;
+}
+
 bool saveScriptStates(const char *filename)
 {
 	WzConfig ini(filename, WzConfig::ReadAndWrite);
@@ -750,6 +1392,7 @@ bool saveScriptStates(const char *filename)
 	{
 		QScriptEngine *engine = scripts.at(i);
 		QScriptValueIterator it(engine->globalObject());
+		std::map<QString, nlohmann::json> &saved = savedGlobals[engine];
 		ini.beginGroup("globals_" + WzString::number(i));
 		// we save 'scriptName' and 'me' implicitly
 		while (it.hasNext())
@@ -758,7 +1401,12 @@ bool saveScriptStates(const char *filename)
 			if (internalNamespace.count(it.name()) == 0 && !it.value().isFunction()
 			    && !it.value().equals(engine->globalObject()))
 			{
-				ini.setValue(WzString::fromUtf8(it.name().toUtf8().constData()), it.value().toVariant());
+				nlohmann::json &global = saved[it.name()];
+				if (!scriptValueEqualsJson(it.value(), global))
+				{
+					global = it.value().toVariant();
+				}
+				ini.setValue(WzString::fromUtf8(it.name().toUtf8().constData()), global);
 			}
 		}
 		ini.endGroup();
@@ -769,10 +1417,11 @@ bool saveScriptStates(const char *filename)
 		saveGroups(ini, engine);
 		ini.endGroup();
 	}
-	for (int i = 0; i < timers.size(); ++i)
+	int i = 0;
+	for (const auto &it : timers)
 	{
-		timerNode node = timers.at(i);
-		ini.beginGroup("triggers_" + WzString::number(i));
+		const timerNode &node = it.second;
+		ini.beginGroup("triggers_" + WzString::number(i++));
 		// we have to save 'scriptName' and 'me' explicitly
 		ini.setValue("me", node.player);
 		ini.setValue("scriptName", QStringToWzString(node.engine->globalObject().property("scriptName").toString()));
@@ -828,20 +1477,35 @@ bool loadScriptStates(const char *filename)
 			node.function = QString::fromUtf8(ini.value("function").toWzString().toUtf8().c_str());
 			node.baseobj = ini.value("baseobj", -1).toInt();
 			node.type = (timerType)ini.value("type", TIMER_REPEAT).toInt();
-			timers.push_back(node);
+			if (node.type != TIMER_ONESHOT_DONE)
+			{
+				addTimer(node);
+			}
 		}
 		else if (engine && list[i].startsWith("globals_"))
 		{
 			std::vector<WzString> keys = ini.childKeys();
 			debug(LOG_SAVE, "Loading script globals for player %d, script %s -- found %zu values",
 			      player, scriptName.toUtf8().constData(), keys.size());
+			std::map<QString, nlohmann::json> &saved = savedGlobals[engine];
 			for (size_t j = 0; j < keys.size(); ++j)
 			{
+				QString name = QString::fromUtf8(keys.at(j).toUtf8().c_str());
+				nlohmann::json instance = ini.json(keys.at(j));
+				// Globals the script set up the same way when it was loaded needn't be built again.
+				QScriptValue value = engine->globalObject().property(name);
+				if (!(value.isNull() && instance.is_null()) && scriptValueEqualsJson(value, instance))
+				{
+					saved[name] = std::move(instance);
+					continue;
+				}
 				// IMPORTANT: "null" JSON values *MUST* map to QScriptValue::UndefinedValue.
 				//			  If they are set to QScriptValue::NullValue, it causes issues for libcampaign.js. (As the values become "defined".)
 				//			  (mapJsonToQScriptValue handles this properly.)
-				engine->globalObject().setProperty(QString::fromUtf8(keys.at(j).toUtf8().c_str()), mapJsonToQScriptValue(engine, ini.json(keys.at(j)), 0));
+				engine->globalObject().setProperty(name, mapJsonToQScriptValue(engine, instance, 0));
+				saved[name] = std::move(instance);
 			}
+			invalidateEventCache(engine);
 		}
 		else if (engine && list[i].startsWith("groups_"))
 		{
@@ -917,8 +1581,9 @@ static void updateGlobalModels()
 	}
 	QStandardItemModel *m = triggerModel;
 	m->setRowCount(0);
-	for (const auto &node : timers)
+	for (const auto &it : timers)
 	{
+		const timerNode &node = it.second;
 		int nextRow = m->rowCount();
 		m->setRowCount(nextRow);
 		m->setItem(nextRow, 0, new QStandardItem(node.function));
@@ -948,6 +1613,28 @@ static void updateGlobalModels()
 		}
 		m->setItem(nextRow, 6, new QStandardItem(QString::number(node.calls)));
 	}
+	m = profileModel;
+	m->setRowCount(0);
+	for (auto i = profilers.constBegin(); i != profilers.constEnd(); ++i)
+	{
+		QString scriptName = i.key()->globalObject().property("scriptName").toString();
+		int player = i.key()->globalObject().property("me").toInt32();
+		for (auto it = i.value()->functions.constBegin(); it != i.value()->functions.constEnd(); ++it)
+		{
+			const PROFILE_BIN &bin = it.value();
+			QStandardItemList list;
+			list += new QStandardItem(it.key());
+			list += new QStandardItem(scriptName + ":" + QString::number(player));
+			list += new QStandardItem();
+			list.last()->setData(bin.calls, Qt::DisplayRole);  // Numbers, so that they sort as numbers.
+			list += new QStandardItem();
+			list.last()->setData(bin.inclusive / 1000, Qt::DisplayRole);
+			list += new QStandardItem();
+			list.last()->setData(bin.exclusive / 1000, Qt::DisplayRole);
+			list += new QStandardItem(bin.native ? "API" : "Script");
+			m->appendRow(list);
+		}
+	}
 }
 
 bool jsEvaluate(QScriptEngine *engine, const QString &text)
@@ -959,7 +1646,10 @@ bool jsEvaluate(QScriptEngine *engine, const QString &text)
 		      text.toUtf8().constData(), syntax.errorMessage().toUtf8().constData());
 		return false;
 	}
+	++eventCaches[engine].running;
 	QScriptValue result = engine->evaluate(text);
+	--eventCaches[engine].running;
+	invalidateEventCache(engine);
 	if (engine->hasUncaughtException())
 	{
 		debug(LOG_ERROR, "Uncaught exception in %s: %s",
@@ -1022,10 +1712,18 @@ void jsShowDebug()
 	triggerModel->setHeaderData(4, Qt::Horizontal, QString("Interval"));
 	triggerModel->setHeaderData(5, Qt::Horizontal, QString("Type"));
 	triggerModel->setHeaderData(6, Qt::Horizontal, QString("Calls"));
+	// Add profile
+	profileModel = new QStandardItemModel(0, 6);
+	profileModel->setHeaderData(0, Qt::Horizontal, QString("Function"));
+	profileModel->setHeaderData(1, Qt::Horizontal, QString("Script"));
+	profileModel->setHeaderData(2, Qt::Horizontal, QString("Calls"));
+	profileModel->setHeaderData(3, Qt::Horizontal, QString("Inclusive (usec)"));
+	profileModel->setHeaderData(4, Qt::Horizontal, QString("Exclusive (usec)"));
+	profileModel->setHeaderData(5, Qt::Horizontal, QString("Type"));
 
 	globalDialog = true;
 	updateGlobalModels();
-	jsDebugCreate(models, triggerModel, createLabelModel(), jsHandleDebugClosed);
+	jsDebugCreate(models, triggerModel, profileModel, createLabelModel(), jsHandleDebugClosed);
 }
 
 // ----------------------------------------------------------------------------------------
@@ -1138,8 +1836,8 @@ bool triggerEvent(SCRIPT_TRIGGER_TYPE trigger, BASE_OBJECT *psObj)
 
 		if (psObj)
 		{
-			int player = engine->globalObject().property("me").toInt32();
-			bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
+			int player = scriptPlayer(engine);
+			bool receiveAll = scriptReceivesAllEvents(engine);
 			if (player != psObj->player && !receiveAll)
 			{
 				continue;
@@ -1291,8 +1989,8 @@ bool triggerEventDroidIdle(DROID *psDroid)
 	ASSERT(scriptsReady, "Scripts not initialized yet");
 	for (auto *engine : scripts)
 	{
-		int player = engine->globalObject().property("me").toInt32();
-		if (player == psDroid->player)
+		int player = scriptPlayer(engine);
+		if (player == psDroid->player && scriptHandlesEvent(engine, "eventDroidIdle"))
 		{
 			QScriptValueList args;
 			args += convDroid(psDroid, engine);
@@ -1313,9 +2011,9 @@ bool triggerEventDroidBuilt(DROID *psDroid, STRUCTURE *psFactory)
 	ASSERT(scriptsReady, "Scripts not initialized yet");
 	for (auto *engine : scripts)
 	{
-		int player = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
-		if (player == psDroid->player || receiveAll)
+		int player = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
+		if ((player == psDroid->player || receiveAll) && scriptHandlesEvent(engine, "eventDroidBuilt"))
 		{
 			QScriptValueList args;
 			args += convDroid(psDroid, engine);
@@ -1340,9 +2038,9 @@ bool triggerEventStructBuilt(STRUCTURE *psStruct, DROID *psDroid)
 	ASSERT(scriptsReady, "Scripts not initialized yet");
 	for (auto *engine : scripts)
 	{
-		int player = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
-		if (player == psStruct->player || receiveAll)
+		int player = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
+		if ((player == psStruct->player || receiveAll) && scriptHandlesEvent(engine, "eventStructureBuilt"))
 		{
 			QScriptValueList args;
 			args += convStructure(psStruct, engine);
@@ -1366,9 +2064,9 @@ bool triggerEventStructDemolish(STRUCTURE *psStruct, DROID *psDroid)
 	ASSERT(scriptsReady, "Scripts not initialized yet");
 	for (auto *engine : scripts)
 	{
-		int player = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
-		if (player == psStruct->player || receiveAll)
+		int player = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
+		if ((player == psStruct->player || receiveAll) && scriptHandlesEvent(engine, "eventStructureDemolish"))
 		{
 			QScriptValueList args;
 			args += convStructure(psStruct, engine);
@@ -1393,9 +2091,9 @@ bool triggerEventStructureReady(STRUCTURE *psStruct)
 	ASSERT(scriptsReady, "Scripts not initialized yet");
 	for (auto *engine : scripts)
 	{
-		int player = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
-		if (player == psStruct->player || receiveAll)
+		int player = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
+		if ((player == psStruct->player || receiveAll) && scriptHandlesEvent(engine, "eventStructureReady"))
 		{
 			QScriptValueList args;
 			args += convStructure(psStruct, engine);
@@ -1410,6 +2108,13 @@ bool triggerEventStructureReady(STRUCTURE *psStruct)
 //__ An event that is run when an object belonging to the script's controlling player is
 //__ attacked. The attacker parameter may be either a structure or a droid.
 //__
+//__ ## eventAttackedBatch(list)
+//__
+//__ Like ```eventAttacked```, but run at most once per game tick, with a list of all the
+//__ [victim, attacker] pairs since the last time, without duplicates. Scripts which have this
+//__ event don't get ```eventAttacked```. Pairs with an object which was destroyed in the meantime
+//__ are left out. (3.4+ only)
+//__
 bool triggerEventAttacked(BASE_OBJECT *psVictim, BASE_OBJECT *psAttacker, int lastHit)
 {
 	ASSERT(scriptsReady, "Scripts not initialized yet");
@@ -1426,9 +2131,13 @@ bool triggerEventAttacked(BASE_OBJECT *psVictim, BASE_OBJECT *psAttacker, int la
 	}
 	for (auto *engine : scripts)
 	{
-		int player = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
-		if (player == psVictim->player || receiveAll)
+		int player = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
+		if ((player == psVictim->player || receiveAll) && scriptHandlesEvent(engine, "eventAttackedBatch"))
+		{
+			attackedBatches[engine].add(psVictim, psAttacker);
+		}
+		else if ((player == psVictim->player || receiveAll) && scriptHandlesEvent(engine, "eventAttacked"))
 		{
 			QScriptValueList args;
 			args += convMax(psVictim, engine);
@@ -1457,9 +2166,9 @@ bool triggerEventResearched(RESEARCH *psResearch, STRUCTURE *psStruct, int playe
 	}
 	for (auto *engine : scripts)
 	{
-		int me = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
-		if (me == player || receiveAll)
+		int me = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
+		if ((me == player || receiveAll) && scriptHandlesEvent(engine, "eventResearched"))
 		{
 			QScriptValueList args;
 			args += convResearch(psResearch, engine, player);
@@ -1489,6 +2198,10 @@ bool triggerEventDestroyed(BASE_OBJECT *psVictim)
 	for (int i = 0; i < scripts.size() && psVictim; ++i)
 	{
 		QScriptEngine *engine = scripts.at(i);
+		if (!scriptHandlesEvent(engine, "eventDestroyed"))
+		{
+			continue;
+		}
 		QScriptValueList args;
 		args += convMax(psVictim, engine);
 		callFunction(engine, "eventDestroyed", args);
@@ -1507,6 +2220,10 @@ bool triggerEventPickup(FEATURE *psFeat, DROID *psDroid)
 	ASSERT(scriptsReady, "Scripts not initialized yet");
 	for (auto *engine : scripts)
 	{
+		if (!scriptHandlesEvent(engine, "eventPickup"))
+		{
+			continue;
+		}
 		QScriptValueList args;
 		args += convFeature(psFeat, engine);
 		args += convDroid(psDroid, engine);
@@ -1523,6 +2240,13 @@ bool triggerEventPickup(FEATURE *psFeat, DROID *psDroid)
 //__ First parameter is **game object** doing the seeing, the next the game
 //__ object being seen.
 //__
+//__ ## eventObjectSeenBatch(list)
+//__
+//__ Like ```eventObjectSeen```, but run at most once per game tick, with a list of all the
+//__ [viewer, seen] pairs since the last time, without duplicates. Scripts which have this
+//__ event don't get ```eventObjectSeen```. Pairs with an object which was destroyed in the
+//__ meantime are left out. (3.4+ only)
+//__
 //__ ## eventGroupSeen(viewer, group)
 //__
 //__ An event that is run sometimes when a member of a group, which was marked by a group label,
@@ -1537,14 +2261,18 @@ bool triggerEventSeen(BASE_OBJECT *psViewer, BASE_OBJECT *psSeen)
 	{
 		QScriptEngine *engine = scripts.at(i);
 		std::pair<bool, int> callbacks = seenLabelCheck(engine, psSeen, psViewer);
-		if (callbacks.first)
+		if (callbacks.first && scriptHandlesEvent(engine, "eventObjectSeenBatch"))
+		{
+			seenBatches[engine].add(psViewer, psSeen);
+		}
+		else if (callbacks.first && scriptHandlesEvent(engine, "eventObjectSeen"))
 		{
 			QScriptValueList args;
 			args += convMax(psViewer, engine);
 			args += convMax(psSeen, engine);
 			callFunction(engine, "eventObjectSeen", args);
 		}
-		if (callbacks.second)
+		if (callbacks.second && scriptHandlesEvent(engine, "eventGroupSeen"))
 		{
 			QScriptValueList args;
 			args += convMax(psViewer, engine);
@@ -1568,9 +2296,9 @@ bool triggerEventObjectTransfer(BASE_OBJECT *psObj, int from)
 	for (int i = 0; i < scripts.size() && psObj; ++i)
 	{
 		QScriptEngine *engine = scripts.at(i);
-		int me = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
-		if (me == psObj->player || me == from || receiveAll)
+		int me = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
+		if ((me == psObj->player || me == from || receiveAll) && scriptHandlesEvent(engine, "eventObjectTransfer"))
 		{
 			QScriptValueList args;
 			args += convMax(psObj, engine);
@@ -1592,8 +2320,8 @@ bool triggerEventChat(int from, int to, const char *message)
 	for (int i = 0; scriptsReady && message && i < scripts.size(); ++i)
 	{
 		QScriptEngine *engine = scripts.at(i);
-		int me = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
+		int me = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
 		if (me == to || (receiveAll && to == from))
 		{
 			QScriptValueList args;
@@ -1616,8 +2344,8 @@ bool triggerEventBeacon(int from, int to, const char *message, int x, int y)
 {
 	for (auto *engine : scripts)
 	{
-		int me = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
+		int me = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
 		if (me == to || receiveAll)
 		{
 			QScriptValueList args;
@@ -1645,8 +2373,8 @@ bool triggerEventBeaconRemoved(int from, int to)
 	ASSERT(scriptsReady, "Scripts not initialized yet");
 	for (auto *engine : scripts)
 	{
-		int me = engine->globalObject().property("me").toInt32();
-		bool receiveAll = engine->globalObject().property("isReceivingAllEvents").toBool();
+		int me = scriptPlayer(engine);
+		bool receiveAll = scriptReceivesAllEvents(engine);
 		if (me == to || receiveAll)
 		{
 			QScriptValueList args;
@@ -1707,11 +2435,15 @@ bool triggerEventDroidMoved(DROID *psDroid, int oldx, int oldy)
 bool triggerEventArea(const QString& label, DROID *psDroid)
 {
 	ASSERT(scriptsReady, "Scripts not initialized yet");
+	QString funcname = QString("eventArea" + label);
 	for (auto *engine : scripts)
 	{
+		if (!scriptHandlesEvent(engine, funcname))
+		{
+			continue;
+		}
 		QScriptValueList args;
 		args += convDroid(psDroid, engine);
-		QString funcname = QString("eventArea" + label);
 		debug(LOG_SCRIPT, "Triggering %s for %s", funcname.toUtf8().constData(),
 		      engine->globalObject().property("scriptName").toString().toUtf8().constData());
 		callFunction(engine, funcname, args);
@@ -103,6 +103,9 @@ bool writeLabels(const char *filename);
 /// Tell script system that an object has been removed.
 void scriptRemoveObject(BASE_OBJECT *psObj);
 
+/// Tell script system that whole object lists are being freed, without removing each object.
+void scriptRemoveAllObjects();
+
 /// Open debug GUI
 void jsShowDebug();
 
@@ -115,6 +118,10 @@ void jsAutogameSpecific(const WzString &name, int player);
 /// Run-time code from user
 bool jsEvaluate(QScriptEngine *engine, const QString &text);
 
+/// Start or stop measuring the time spent in each script function. Stopping writes logs/<script>.<player>.folded for flame graphs.
+void jsSetProfiling(bool enable);
+bool jsIsProfiling();
+
 /// Run a named script callback
 bool namedScriptCallback(QScriptEngine *engine, const WzString& func, int player);
 
@@ -261,7 +261,7 @@ static void fillPlayerModel(QStandardItemModel &m, int i)
 #undef KEYVAL
 }
 
-ScriptDebugger::ScriptDebugger(const MODELMAP &models, QStandardItemModel *triggerModel, QStandardItemModel *_labelModel)
+ScriptDebugger::ScriptDebugger(const MODELMAP &models, QStandardItemModel *triggerModel, QStandardItemModel *profileModel, QStandardItemModel *_labelModel)
 : QDialog(nullptr, Qt::Window)
 , labelModel(_labelModel)
 {
@@ -393,6 +393,32 @@ ScriptDebugger::ScriptDebugger(const MODELMAP &models, QStandardItemModel *trigg
 	triggerView.setSelectionBehavior(QAbstractItemView::SelectRows);
 	tab.addTab(&triggerView, "Triggers");
 
+	// Add profile
+	profileModel->setParent(this); // take ownership to avoid memory leaks
+	profileView.setModel(profileModel);
+	profileView.setSortingEnabled(true);
+	profileView.sortByColumn(4, Qt::DescendingOrder);
+	profileView.resizeColumnToContents(0);
+	profileView.setSelectionMode(QAbstractItemView::NoSelection);
+	profileView.setSelectionBehavior(QAbstractItemView::SelectRows);
+	QPushButton *profileButton = new QPushButton(jsIsProfiling() ? "Stop profiling" : "Start profiling", this);
+	QPushButton *profileUpdateButton = new QPushButton("Update", this);
+	connect(profileButton, &QPushButton::pressed, [=] {
+		jsSetProfiling(!jsIsProfiling());
+		profileButton->setText(jsIsProfiling() ? "Stop profiling" : "Start profiling");
+		updateModels();
+	});
+	connect(profileUpdateButton, SIGNAL(pressed()), this, SLOT(updateModels()));
+	QHBoxLayout *profileButtonLayout = new QHBoxLayout;
+	profileButtonLayout->addWidget(profileButton);
+	profileButtonLayout->addWidget(profileUpdateButton);
+	QVBoxLayout *profileLayout = new QVBoxLayout;
+	profileLayout->addWidget(&profileView);
+	profileLayout->addLayout(profileButtonLayout);
+	QWidget *profileWidget = new QWidget(this);
+	profileWidget->setLayout(profileLayout);
+	tab.addTab(profileWidget, "Profile");
+
 	// Add messages
 	QTabWidget *messTab = new QTabWidget(this);
 	messageView.setModel(&messageModel);
@@ -839,9 +865,9 @@ bool jsDebugShutdown()
 	return true;
 }
 
-void jsDebugCreate(const MODELMAP &models, QStandardItemModel *triggerModel, QStandardItemModel *labelModel, const jsDebugShutdownHandlerFunction& shutdownFunc)
+void jsDebugCreate(const MODELMAP &models, QStandardItemModel *triggerModel, QStandardItemModel *profileModel, QStandardItemModel *labelModel, const jsDebugShutdownHandlerFunction& shutdownFunc)
 {
 	jsDebugShutdown();
 	globalDialogShutdownHandler = shutdownFunc;
-	globalDialog = new ScriptDebugger(models, triggerModel, labelModel);
+	globalDialog = new ScriptDebugger(models, triggerModel, profileModel, labelModel);
 }
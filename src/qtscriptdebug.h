@@ -55,7 +55,7 @@ class ScriptDebugger : public QDialog
 	Q_OBJECT
 
 public:
-	ScriptDebugger(const MODELMAP &models, QStandardItemModel *triggerModel, QStandardItemModel *labelModel);
+	ScriptDebugger(const MODELMAP &models, QStandardItemModel *triggerModel, QStandardItemModel *profileModel, QStandardItemModel *labelModel);
 	~ScriptDebugger();
 	void selected(const BASE_OBJECT *psObj);
 	void updateMessages();
@@ -72,6 +72,7 @@ private:
 	QTreeView selectedView;
 	QTreeView labelView;
 	QTreeView triggerView;
+	QTreeView profileView;
 	QTreeView messageView;
 	QTreeView viewdataView;
 	QTreeView mainView;
@@ -110,7 +111,7 @@ protected slots:
 };
 
 typedef std::function<void ()> jsDebugShutdownHandlerFunction;
-void jsDebugCreate(const MODELMAP &models, QStandardItemModel *triggerModel, QStandardItemModel *labelModel, const jsDebugShutdownHandlerFunction& shutdownFunc);
+void jsDebugCreate(const MODELMAP &models, QStandardItemModel *triggerModel, QStandardItemModel *profileModel, QStandardItemModel *labelModel, const jsDebugShutdownHandlerFunction& shutdownFunc);
 bool jsDebugShutdown();
 
 // jsDebugSelected() and jsDebugMessageUpdate() defined in qtscript.h since it is used widely
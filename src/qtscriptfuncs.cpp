@@ -33,6 +33,7 @@
 #include <QtCore/QJsonArray>
 #include <QtGui/QStandardItemModel>
 #include <QtCore/QPointer>
+#include <QtCore/QHash>
 
 #if defined(__GNUC__) && !defined(__INTEL_COMPILER) && !defined(__clang__) && (9 <= __GNUC__)
 # pragma GCC diagnostic pop // Workaround Qt < 5.13 `deprecated-copy` issues with GCC 9
@@ -86,6 +87,8 @@
 #include "advvis.h"
 #include "loadsave.h"
 
+#include <algorithm>
+
 #define ALL_PLAYERS -1
 #define ALLIES -2
 #define ENEMIES -3
@@ -223,6 +226,30 @@ typedef QMap<BASE_OBJECT *, int> GROUPMAP;
 typedef QMap<QScriptEngine *, GROUPMAP *> ENGINEMAP;
 static ENGINEMAP groups;
 
+/// Results of the snapshot functions in the current game tick, by function and arguments, so that
+/// identical queries in the same tick are only done once.
+struct SNAPSHOT_CACHE
+{
+	uint32_t gameTime = 0;
+	QHash<QString, QScriptValue> results;
+};
+static QHash<QScriptEngine *, SNAPSHOT_CACHE> snapshots;
+
+/// The droids and structures of a player, sorted by type, so that the enum functions only look at the
+/// objects of the wanted type. Rebuilt when objects are added to or removed from the player's lists, or
+/// the lists are swapped for the mission lists. Dead objects stay until then, so check 'died'.
+struct SCRIPT_VIEW
+{
+	bool valid = false;
+	uint32_t changes = 0;
+	DROID *droidList = nullptr;
+	STRUCTURE *structList = nullptr;
+	std::vector<std::pair<int, DROID *>> droids[DROID_ANY];  ///< By droid type, with their positions in the droid list.
+	std::vector<STRUCTURE *> structs[NUM_DIFF_BUILDINGS];   ///< By structure type, in list order.
+};
+static SCRIPT_VIEW scriptViews[MAX_PLAYERS];
+static wz::mutex scriptViewMutex;  ///< Scripts on worker threads may build the views.
+
 struct LABEL
 {
 	Vector2i p1, p2;
@@ -961,6 +988,122 @@ QScriptValue convMax(BASE_OBJECT *psObj, QScriptEngine *engine)
 	}
 }
 
+static QScriptValue objHealth(BASE_OBJECT *psObj)
+{
+	switch (psObj->type)
+	{
+	case OBJ_DROID: return 100.0 / (double)((DROID *)psObj)->originalBody * (double)((DROID *)psObj)->body;
+	case OBJ_STRUCTURE: return 100 * psObj->body / MAX(1, structureBody((STRUCTURE *)psObj));
+	case OBJ_FEATURE: return 100 * ((FEATURE *)psObj)->psStats->body / MAX(1, psObj->body);
+	default: return QScriptValue::NullValue;
+	}
+}
+
+//;; ## Snapshot
+//;;
+//;; Describes a list of game objects, as returned by the snapshot functions. Instead of one
+//;; object per game object, it holds one array per property, so the properties of the i-th
+//;; game object are ```id[i]```, ```type[i]``` and so on. Use ```getObject(type[i], player[i], id[i])```
+//;; to get the full game object. The following properties are defined:
+//;;
+//;; * ```length``` The number of game objects.
+//;; * ```id``` The IDs of the game objects.
+//;; * ```type``` Their types, one of DROID, STRUCTURE or FEATURE.
+//;; * ```player``` The players owning them.
+//;; * ```x``` Their X coordinates.
+//;; * ```y``` Their Y coordinates.
+//;; * ```health``` Their health, in percent.
+//;;
+template <typename T>
+static QScriptValue convSnapshot(const QList<T *> &list, QScriptEngine *engine)
+{
+	QScriptValue id = engine->newArray(list.size());
+	QScriptValue type = engine->newArray(list.size());
+	QScriptValue player = engine->newArray(list.size());
+	QScriptValue x = engine->newArray(list.size());
+	QScriptValue y = engine->newArray(list.size());
+	QScriptValue health = engine->newArray(list.size());
+	for (int i = 0; i < list.size(); i++)
+	{
+		BASE_OBJECT *psObj = list[i];
+		id.setProperty(i, psObj->id);
+		type.setProperty(i, psObj->type);
+		player.setProperty(i, psObj->player);
+		x.setProperty(i, map_coord(psObj->pos.x));
+		y.setProperty(i, map_coord(psObj->pos.y));
+		health.setProperty(i, objHealth(psObj));
+	}
+	QScriptValue value = engine->newObject();
+	value.setProperty("length", list.size(), QScriptValue::ReadOnly);
+	value.setProperty("id", id, QScriptValue::ReadOnly);
+	value.setProperty("type", type, QScriptValue::ReadOnly);
+	value.setProperty("player", player, QScriptValue::ReadOnly);
+	value.setProperty("x", x, QScriptValue::ReadOnly);
+	value.setProperty("y", y, QScriptValue::ReadOnly);
+	value.setProperty("health", health, QScriptValue::ReadOnly);
+	return value;
+}
+
+static const SCRIPT_VIEW &scriptView(int player)
+{
+	std::lock_guard<wz::mutex> lock(scriptViewMutex);
+	SCRIPT_VIEW &view = scriptViews[player];
+	if (view.valid && view.changes == objListChanges[player] && view.droidList == apsDroidLists[player] && view.structList == apsStructLists[player])
+	{
+		return view;
+	}
+	view.valid = true;
+	view.changes = objListChanges[player];
+	view.droidList = apsDroidLists[player];
+	view.structList = apsStructLists[player];
+	for (auto &droids : view.droids)
+	{
+		droids.clear();
+	}
+	for (auto &structs : view.structs)
+	{
+		structs.clear();
+	}
+	int position = 0;
+	for (DROID *psDroid = apsDroidLists[player]; psDroid; psDroid = psDroid->psNext, ++position)
+	{
+		ASSERT_OR_RETURN(view, psDroid->droidType < DROID_ANY, "Bad droid type %d", psDroid->droidType);
+		view.droids[psDroid->droidType].push_back(std::make_pair(position, psDroid));
+	}
+	for (STRUCTURE *psStruct = apsStructLists[player]; psStruct; psStruct = psStruct->psNext)
+	{
+		view.structs[psStruct->pStructureType->type].push_back(psStruct);
+	}
+	return view;
+}
+
+/// Calls the enum function with the arguments of the snapshot function, unless it was already called with the same arguments in this game tick.
+static QScriptValue cachedSnapshot(QScriptContext *context, QScriptEngine *engine, const char *function, QScriptValue (*enumFunction)(QScriptContext *, QScriptEngine *, bool))
+{
+	SNAPSHOT_CACHE &cache = snapshots[engine];
+	if (cache.gameTime != gameTime)
+	{
+		cache.gameTime = gameTime;
+		cache.results.clear();
+	}
+	QString key = function;
+	for (int i = 0; i < context->argumentCount(); i++)
+	{
+		key += "," + context->argument(i).toString();
+	}
+	auto it = cache.results.constFind(key);
+	if (it != cache.results.constEnd())
+	{
+		return *it;
+	}
+	QScriptValue value = enumFunction(context, engine, true);
+	if (context->state() != QScriptContext::ExceptionState)
+	{
+		cache.results.insert(key, value);
+	}
+	return value;
+}
+
 BASE_OBJECT *IdToObject(OBJECT_TYPE type, int id, int player)
 {
 	switch (type)
@@ -2122,7 +2265,7 @@ static QScriptValue js_buildDroid(QScriptContext *context, QScriptEngine *engine
 //-- third parameter can be used to filter by visibility, the default is not
 //-- to filter.
 //--
-static QScriptValue js_enumStruct(QScriptContext *context, QScriptEngine *engine)
+static QScriptValue enumStruct(QScriptContext *context, QScriptEngine *engine, bool snapshot)
 {
 	QList<STRUCTURE *> matches;
 	int player = -1, looking = -1;
@@ -2149,16 +2292,44 @@ static QScriptValue js_enumStruct(QScriptContext *context, QScriptEngine *engine
 
 	SCRIPT_ASSERT_PLAYER(context, player);
 	SCRIPT_ASSERT(context, looking < MAX_PLAYERS && looking >= -1, "Looking player index out of range: %d", looking);
-	for (STRUCTURE *psStruct = apsStructLists[player]; psStruct; psStruct = psStruct->psNext)
+	const STRUCTURE_STATS *psStats = nullptr;
+	if (!statsName.isEmpty())
 	{
-		if ((looking == -1 || psStruct->visible[looking])
-		    && !psStruct->died
-		    && (type == NUM_DIFF_BUILDINGS || type == psStruct->pStructureType->type)
-		    && (statsName.isEmpty() || statsName.compare(psStruct->pStructureType->id) == 0))
+		// getStructStatFromName looks the name up in all stats, so the index might belong to a component.
+		int index = getStructStatFromName(statsName);
+		if (index < 0 || (unsigned)index >= numStructureStats || asStructureStats[index].id != statsName)
 		{
-			matches.push_back(psStruct);
+			return snapshot ? convSnapshot(matches, engine) : engine->newArray(0);
+		}
+		psStats = &asStructureStats[index];
+		type = psStats->type;
+	}
+	if (type == NUM_DIFF_BUILDINGS)
+	{
+		for (STRUCTURE *psStruct = apsStructLists[player]; psStruct; psStruct = psStruct->psNext)
+		{
+			if ((looking == -1 || psStruct->visible[looking]) && !psStruct->died)
+			{
+				matches.push_back(psStruct);
+			}
 		}
 	}
+	else if (type >= 0 && type < NUM_DIFF_BUILDINGS)
+	{
+		for (STRUCTURE *psStruct : scriptView(player).structs[type])
+		{
+			if ((looking == -1 || psStruct->visible[looking])
+			    && !psStruct->died
+			    && (psStats == nullptr || psStruct->pStructureType == psStats))
+			{
+				matches.push_back(psStruct);
+			}
+		}
+	}
+	if (snapshot)
+	{
+		return convSnapshot(matches, engine);
+	}
 	QScriptValue result = engine->newArray(matches.size());
 	for (int i = 0; i < matches.size(); i++)
 	{
@@ -2168,6 +2339,22 @@ static QScriptValue js_enumStruct(QScriptContext *context, QScriptEngine *engine
 	return result;
 }
 
+static QScriptValue js_enumStruct(QScriptContext *context, QScriptEngine *engine)
+{
+	return enumStruct(context, engine, false);
+}
+
+//-- ## enumStructSnapshot([player[, structure type[, looking player]]])
+//--
+//-- Like ```enumStruct()```, but returns a ```Snapshot``` of the structures, which is much
+//-- cheaper to make when only their positions, owners or health are needed. Calls with the
+//-- same parameters in the same game tick return the same snapshot, which must not be modified. (3.4+ only)
+//--
+static QScriptValue js_enumStructSnapshot(QScriptContext *context, QScriptEngine *engine)
+{
+	return cachedSnapshot(context, engine, "enumStruct", enumStruct);
+}
+
 //-- ## enumStructOffWorld([player[, structure type[, looking player]]])
 //--
 //-- Returns an array of structure objects in your base when on an off-world mission, NULL otherwise.
@@ -2288,7 +2475,7 @@ static QScriptValue js_enumCargo(QScriptContext *context, QScriptEngine *engine)
 //-- is the name of the droid type. The third parameter can be used to filter by
 //-- visibility - the default is not to filter.
 //--
-static QScriptValue js_enumDroid(QScriptContext *context, QScriptEngine *engine)
+static QScriptValue enumDroid(QScriptContext *context, QScriptEngine *engine, bool snapshot)
 {
 	QList<DROID *> matches;
 	int player = -1, looking = -1;
@@ -2319,15 +2506,39 @@ static QScriptValue js_enumDroid(QScriptContext *context, QScriptEngine *engine)
 	}
 	SCRIPT_ASSERT_PLAYER(context, player);
 	SCRIPT_ASSERT(context, looking < MAX_PLAYERS && looking >= -1, "Looking player index out of range: %d", looking);
-	for (DROID *psDroid = apsDroidLists[player]; psDroid; psDroid = psDroid->psNext)
+	if (droidType == DROID_ANY)
 	{
-		if ((looking == -1 || psDroid->visible[looking])
-		    && !psDroid->died
-		    && (droidType == DROID_ANY || droidType == psDroid->droidType || droidType2 == psDroid->droidType))
+		for (DROID *psDroid = apsDroidLists[player]; psDroid; psDroid = psDroid->psNext)
 		{
-			matches.push_back(psDroid);
+			if ((looking == -1 || psDroid->visible[looking]) && !psDroid->died)
+			{
+				matches.push_back(psDroid);
+			}
+		}
+	}
+	else if (droidType >= 0 && droidType < DROID_ANY)
+	{
+		// Merge the droids of both types back into droid list order.
+		const SCRIPT_VIEW &view = scriptView(player);
+		std::vector<std::pair<int, DROID *>> droids = view.droids[droidType];
+		if (droidType2 != droidType)
+		{
+			droids.insert(droids.end(), view.droids[droidType2].begin(), view.droids[droidType2].end());
+			std::inplace_merge(droids.begin(), droids.begin() + view.droids[droidType].size(), droids.end());
+		}
+		for (const auto &droid : droids)
+		{
+			DROID *psDroid = droid.second;
+			if ((looking == -1 || psDroid->visible[looking]) && !psDroid->died)
+			{
+				matches.push_back(psDroid);
+			}
 		}
 	}
+	if (snapshot)
+	{
+		return convSnapshot(matches, engine);
+	}
 	QScriptValue result = engine->newArray(matches.size());
 	for (int i = 0; i < matches.size(); i++)
 	{
@@ -2337,6 +2548,22 @@ static QScriptValue js_enumDroid(QScriptContext *context, QScriptEngine *engine)
 	return result;
 }
 
+static QScriptValue js_enumDroid(QScriptContext *context, QScriptEngine *engine)
+{
+	return enumDroid(context, engine, false);
+}
+
+//-- ## enumDroidSnapshot([player[, droid type[, looking player]]])
+//--
+//-- Like ```enumDroid()```, but returns a ```Snapshot``` of the droids, which is much
+//-- cheaper to make when only their positions, owners or health are needed. Calls with the
+//-- same parameters in the same game tick return the same snapshot, which must not be modified. (3.4+ only)
+//--
+static QScriptValue js_enumDroidSnapshot(QScriptContext *context, QScriptEngine *engine)
+{
+	return cachedSnapshot(context, engine, "enumDroid", enumDroid);
+}
+
 void dumpScriptLog(const QString &scriptName, int me, const QString &info)
 {
 	QString path = PHYSFS_getWriteDir();
@@ -3158,7 +3385,7 @@ static QScriptValue js_gameOverMessage(QScriptContext *context, QScriptEngine *e
 	if (autogame_enabled())
 	{
 		debug(LOG_WARNING, "Autogame completed successfully!");
-		exit(0);
+		wzQuit();  // Not exit(), which would destroy the still running file I/O threads.
 	}
 	return QScriptValue();
 }
@@ -4104,9 +4331,23 @@ static QScriptValue js_loadLevel(QScriptContext *context, QScriptEngine *)
 	// Get the mission rolling...
 	nextMissionType = psNewLevel->type;
 	loopMissionState = LMS_CLEAROBJECTS;
+
+	// Read the level data while the old level is being cleared
+	levPrefetch(aLevelName);
 	return QScriptValue();
 }
 
+//-- ## prefetchLevel(level name)
+//--
+//-- Start reading the data of the level with the given name in the background, so that a
+//-- later ```loadLevel()``` of it is faster. Returns false if there is no such level. (3.4+ only)
+//--
+static QScriptValue js_prefetchLevel(QScriptContext *context, QScriptEngine *)
+{
+	QString level = context->argument(0).toString();
+	return QScriptValue(levPrefetch(level.toUtf8().constData()));
+}
+
 //-- ## autoSave()
 //--
 //-- Perform automatic save
@@ -4125,7 +4366,7 @@ static QScriptValue js_autoSave(QScriptContext *, QScriptEngine *engine)
 //-- returned; by default only visible objects are returned. Calling this function is much faster than
 //-- iterating over all game objects using other enum functions. (3.2+ only)
 //--
-static QScriptValue js_enumRange(QScriptContext *context, QScriptEngine *engine)
+static QScriptValue enumRange(QScriptContext *context, QScriptEngine *engine, bool snapshot)
 {
 	int player = engine->globalObject().property("me").toInt32();
 	int x = world_coord(context->argument(0).toInt32());
@@ -4157,6 +4398,10 @@ static QScriptValue js_enumRange(QScriptContext *context, QScriptEngine *engine)
 			}
 		}
 	}
+	if (snapshot)
+	{
+		return convSnapshot(list, engine);
+	}
 	QScriptValue value = engine->newArray(list.size());
 	for (int i = 0; i < list.size(); i++)
 	{
@@ -4165,6 +4410,22 @@ static QScriptValue js_enumRange(QScriptContext *context, QScriptEngine *engine)
 	return value;
 }
 
+static QScriptValue js_enumRange(QScriptContext *context, QScriptEngine *engine)
+{
+	return enumRange(context, engine, false);
+}
+
+//-- ## enumRangeSnapshot(x, y, range[, filter[, seen]])
+//--
+//-- Like ```enumRange()```, but returns a ```Snapshot``` of the game objects, which is much
+//-- cheaper to make when only their positions, owners or health are needed. Calls with the
+//-- same parameters in the same game tick return the same snapshot, which must not be modified. (3.4+ only)
+//--
+static QScriptValue js_enumRangeSnapshot(QScriptContext *context, QScriptEngine *engine)
+{
+	return cachedSnapshot(context, engine, "enumRange", enumRange);
+}
+
 //-- ## enumArea(<x1, y1, x2, y2 | label>[, filter[, seen]])
 //--
 //-- Returns an array of game objects seen within the given area that passes the optional filter
@@ -5071,6 +5332,7 @@ bool unregisterFunctions(QScriptEngine *engine)
 	int num = groups.remove(engine);
 	delete psMap;
 	ASSERT(num == 1, "Number of engines removed from group map is %d!", num);
+	snapshots.remove(engine);
 	labels.clear();
 	labelModel = nullptr;
 	return true;
@@ -5787,6 +6049,7 @@ bool registerFunctions(QScriptEngine *engine, const QString& scriptName)
 	// Create group map
 	GROUPMAP *psMap = new GROUPMAP;
 	groups.insert(engine, psMap);
+	snapshots.insert(engine, SNAPSHOT_CACHE());  // Now, since scripts on worker threads can't add it.
 
 	/// Register 'Stats' object. It is a read-only representation of basic game component states.
 	//== * ```Stats``` A sparse, read-only array containing rules information for game entity types.
@@ -6200,14 +6463,17 @@ bool registerFunctions(QScriptEngine *engine, const QString& scriptName)
 	engine->globalObject().setProperty("clearConsole", engine->newFunction(js_clearConsole));
 	engine->globalObject().setProperty("structureIdle", engine->newFunction(js_structureIdle));
 	engine->globalObject().setProperty("enumStruct", engine->newFunction(js_enumStruct));
+	engine->globalObject().setProperty("enumStructSnapshot", engine->newFunction(js_enumStructSnapshot));
 	engine->globalObject().setProperty("enumStructOffWorld", engine->newFunction(js_enumStructOffWorld));
 	engine->globalObject().setProperty("enumDroid", engine->newFunction(js_enumDroid));
+	engine->globalObject().setProperty("enumDroidSnapshot", engine->newFunction(js_enumDroidSnapshot));
 	engine->globalObject().setProperty("enumGroup", engine->newFunction(js_enumGroup));
 	engine->globalObject().setProperty("enumFeature", engine->newFunction(js_enumFeature));
 	engine->globalObject().setProperty("enumBlips", engine->newFunction(js_enumBlips));
 	engine->globalObject().setProperty("enumSelected", engine->newFunction(js_enumSelected));
 	engine->globalObject().setProperty("enumResearch", engine->newFunction(js_enumResearch));
 	engine->globalObject().setProperty("enumRange", engine->newFunction(js_enumRange));
+	engine->globalObject().setProperty("enumRangeSnapshot", engine->newFunction(js_enumRangeSnapshot));
 	engine->globalObject().setProperty("enumArea", engine->newFunction(js_enumArea));
 	engine->globalObject().setProperty("getResearch", engine->newFunction(js_getResearch));
 	engine->globalObject().setProperty("pursueResearch", engine->newFunction(js_pursueResearch));
@@ -6294,6 +6560,7 @@ bool registerFunctions(QScriptEngine *engine, const QString& scriptName)
 	engine->globalObject().setProperty("countStruct", engine->newFunction(js_countStruct));
 	engine->globalObject().setProperty("countDroid", engine->newFunction(js_countDroid));
 	engine->globalObject().setProperty("loadLevel", engine->newFunction(js_loadLevel));
+	engine->globalObject().setProperty("prefetchLevel", engine->newFunction(js_prefetchLevel));
 	engine->globalObject().setProperty("setDroidExperience", engine->newFunction(js_setDroidExperience));
 	engine->globalObject().setProperty("donateObject", engine->newFunction(js_donateObject));
 	engine->globalObject().setProperty("donatePower", engine->newFunction(js_donatePower));
@@ -0,0 +1,312 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2020  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file replay.cpp
+ *  Recording multiplayer games, and setting up the same game again to play one back.
+ */
+
+#include "lib/framework/frame.h"
+#include "lib/framework/physfs_ext.h"
+#include "lib/framework/wzapp.h"
+#include "lib/gamelib/gtime.h"
+#include "lib/netplay/netplay.h"
+#include "lib/netplay/netreplay.h"
+
+#include "replay.h"
+#include "ai.h"
+#include "clparse.h"
+#include "component.h"
+#include "multiplay.h"
+#include "random.h"
+#include "version.h"
+
+#include <algorithm>
+#include <time.h>
+#include <3rdparty/json/json.hpp>
+using json = nlohmann::json;
+
+static bool replayRecording = true;  ///< Whether multiplayer and skirmish games are recorded.
+static int replayMaxFiles = 20;  ///< When there are this many replays, delete the oldest before recording another one.
+
+static const uint32_t replayStalledTicks = 2000;  ///< The replay has ended when all messages are queued, and the game time hasn't changed for this long.
+
+static uint32_t replayRandomSeed = 0;
+static std::vector<MULTISTRUCTLIMITS> replayStructureLimits;
+
+static bool replayReported = false;
+static uint32_t replayStartRealTime = 0;
+static uint32_t replayLastGameTime = 0;
+static uint32_t replayLastGameTimeRealTime = 0;
+static int replayExitStatus = EXIT_SUCCESS;
+
+static void freeReplaySlot()
+{
+	char **files = PHYSFS_enumerateFiles(REPLAY_DIR);
+	std::vector<std::pair<PHYSFS_sint64, std::string>> replays;
+	for (char **i = files; *i != nullptr; ++i)
+	{
+		if (!strstr(*i, ".wzrp"))
+		{
+			continue;
+		}
+		std::string replayPath = std::string(REPLAY_DIR "/") + *i;
+		replays.emplace_back(WZ_PHYSFS_getLastModTime(replayPath.c_str()), replayPath);
+	}
+	PHYSFS_freeList(files);
+
+	// Delete the oldest ones, more than one if the limit was lowered since.
+	std::sort(replays.begin(), replays.end());
+	for (size_t n = 0; n + static_cast<size_t>(replayMaxFiles) <= replays.size(); ++n)
+	{
+		if (PHYSFS_delete(replays[n].second.c_str()) == 0)
+		{
+			debug(LOG_ERROR, "Could not delete old replay %s: %s", replays[n].second.c_str(), WZ_PHYSFS_getLastError());
+		}
+	}
+}
+
+void replaySetRecording(bool enable)
+{
+	replayRecording = enable;
+}
+
+bool replayGetRecording()
+{
+	return replayRecording;
+}
+
+void replaySetMaxFiles(int maxFiles)
+{
+	replayMaxFiles = std::max(maxFiles, 1);
+}
+
+int replayGetMaxFiles()
+{
+	return replayMaxFiles;
+}
+
+void replayStartRecording()
+{
+	if (!replayRecording || NETisReplay())
+	{
+		return;  // Turned off, or don't record a replay of a replay.
+	}
+	freeReplaySlot();
+
+	json settings = json::object();
+	settings["version"] = version_getVersionString();
+	settings["randomSeed"] = gameRandSeed();
+	settings["selectedPlayer"] = selectedPlayer;
+	settings["hostPlayer"] = NetPlay.hostPlayer;
+	settings["map"] = game.map;
+	settings["hash"] = game.hash.toString();
+	settings["type"] = game.type;
+	settings["maxPlayers"] = game.maxPlayers;
+	settings["scavengers"] = game.scavengers;
+	settings["power"] = game.power;
+	settings["base"] = game.base;
+	settings["alliance"] = game.alliance;
+	settings["techLevel"] = game.techLevel;
+
+	json limits = json::array();
+	for (auto const &structLimit : ingame.structureLimits)
+	{
+		limits.push_back({structLimit.id, structLimit.limit});
+	}
+	settings["structureLimits"] = limits;
+
+	json players = json::array();
+	for (unsigned i = 0; i < MAX_PLAYERS; ++i)
+	{
+		PLAYER const &p = NetPlay.players[i];
+		json player = json::object();
+		player["name"] = p.name;
+		player["position"] = p.position;
+		player["colour"] = p.colour;
+		player["allocated"] = p.allocated;
+		player["team"] = p.team;
+		player["ai"] = p.ai;
+		player["difficulty"] = p.difficulty;
+		player["skDiff"] = game.skDiff[i];
+		player["alliances"] = std::vector<uint8_t>(alliances[i], alliances[i] + MAX_PLAYERS);
+		players.push_back(player);
+	}
+	settings["players"] = players;
+
+	std::string settingsString;
+	try
+	{
+		settingsString = settings.dump();
+	}
+	catch (const std::exception &e)
+	{
+		debug(LOG_ERROR, "Could not write replay settings: %s", e.what());  // A player name which isn't valid UTF-8, for example.
+		return;
+	}
+
+	time_t now = time(nullptr);
+	char date[PATH_MAX];
+	strftime(date, sizeof(date), "%F_%H%M%S", localtime(&now));
+	char fileName[PATH_MAX];
+	snprintf(fileName, sizeof(fileName), REPLAY_DIR "/%s_%s.wzrp", game.map, date);
+	NETreplaySaveStart(fileName, settingsString);
+}
+
+void replayStop()
+{
+	NETreplaySaveStop();
+	NETreplayLoadStop();
+}
+
+bool replayLoad(const char *fileName)
+{
+	std::string settingsString;
+	if (!NETreplayLoadStart(fileName, &settingsString))
+	{
+		return false;
+	}
+
+	try
+	{
+		json settings = json::parse(settingsString);
+
+		std::string version = settings.at("version").get<std::string>();
+		if (version != version_getVersionString())
+		{
+			debug(LOG_WARNING, "Replay %s was recorded with version %s, it will probably desynch.", fileName, version.c_str());
+		}
+
+		replayRandomSeed = settings.at("randomSeed").get<uint32_t>();
+		replayStructureLimits.clear();
+		for (auto const &structLimit : settings.at("structureLimits"))
+		{
+			replayStructureLimits.push_back(MULTISTRUCTLIMITS {structLimit.at(0).get<uint32_t>(), structLimit.at(1).get<uint32_t>()});
+		}
+
+		sstrcpy(game.map, settings.at("map").get<std::string>().c_str());
+		game.hash.fromString(settings.at("hash").get<std::string>());
+		game.type = settings.at("type").get<uint8_t>();
+		game.maxPlayers = settings.at("maxPlayers").get<uint8_t>();
+		game.scavengers = settings.at("scavengers").get<bool>();
+		game.power = settings.at("power").get<uint32_t>();
+		game.base = settings.at("base").get<uint8_t>();
+		game.alliance = settings.at("alliance").get<uint8_t>();
+		game.techLevel = settings.at("techLevel").get<uint32_t>();
+
+		json const &players = settings.at("players");
+		for (unsigned i = 0; i < MAX_PLAYERS && i < players.size(); ++i)
+		{
+			json const &player = players[i];
+			sstrcpy(NetPlay.players[i].name, player.at("name").get<std::string>().c_str());
+			NetPlay.players[i].position = player.at("position").get<int32_t>();
+			setPlayerColour(i, player.at("colour").get<int32_t>());
+			NetPlay.players[i].allocated = player.at("allocated").get<bool>();
+			NetPlay.players[i].team = player.at("team").get<int32_t>();
+			NetPlay.players[i].ai = player.at("ai").get<int8_t>();
+			NetPlay.players[i].difficulty = player.at("difficulty").get<int8_t>();
+			game.skDiff[i] = player.at("skDiff").get<uint8_t>();
+			json const &playerAlliances = player.at("alliances");
+			for (unsigned j = 0; j < MAX_PLAYERS && j < playerAlliances.size(); ++j)
+			{
+				alliances[i][j] = playerAlliances[j].get<uint8_t>();
+			}
+		}
+
+		// Watch the game from the point of view of whoever recorded it.
+		uint32_t recordedPlayer = settings.at("selectedPlayer").get<uint32_t>();
+		if (recordedPlayer >= MAX_PLAYERS)
+		{
+			throw std::out_of_range("selectedPlayer");
+		}
+		selectedPlayer = recordedPlayer;
+		realSelectedPlayer = selectedPlayer;
+		NetPlay.hostPlayer = settings.at("hostPlayer").get<uint32_t>();
+	}
+	catch (const std::exception &e)
+	{
+		debug(LOG_ERROR, "Bad settings in replay %s: %s", fileName, e.what());
+		NETreplayLoadStop();
+		return false;
+	}
+
+	replayReported = false;
+	replayStartRealTime = 0;
+	replayLastGameTime = 0;
+	replayLastGameTimeRealTime = 0;
+
+	netPlayersUpdated = true;
+	return true;
+}
+
+void replayGameStarting(uint32_t *randomSeed)
+{
+	*randomSeed = replayRandomSeed;
+	ingame.structureLimits = replayStructureLimits;
+}
+
+void replayUpdate()
+{
+	if (!NETisReplay() || replayReported)
+	{
+		return;
+	}
+
+	uint32_t now = wzGetTicks();
+	if (replayStartRealTime == 0)
+	{
+		replayStartRealTime = now;
+	}
+	if (replayLastGameTimeRealTime == 0 || gameTime != replayLastGameTime)
+	{
+		replayLastGameTime = gameTime;
+		replayLastGameTimeRealTime = now;
+	}
+	if (!NETreplayFinished() || now - replayLastGameTimeRealTime < replayStalledTicks)
+	{
+		return;
+	}
+	replayReported = true;
+
+	unsigned updates = replayLastGameTime / GAME_TICKS_PER_UPDATE;
+	unsigned milliseconds = std::max(replayLastGameTimeRealTime - replayStartRealTime, 1u);
+	double updatesPerSecond = updates * 1000.0 / milliseconds;
+	uint32_t desynchGameTime = 0;
+	unsigned desynchPlayer = 0;
+	bool desynched = NETreplayFirstDesynch(&desynchGameTime, &desynchPlayer);
+	if (desynched)
+	{
+		debug(LOG_ERROR, "Replay finished, %u game updates in %u ms (%.1f updates/s). First desynch at gameTime %u, against player %u, see logs/desync%u_p%u.txt.",
+		      updates, milliseconds, updatesPerSecond, desynchGameTime, desynchPlayer, desynchGameTime, selectedPlayer);
+	}
+	else
+	{
+		debug(LOG_INFO, "Replay finished, %u game updates in %u ms (%.1f updates/s). No desynch.", updates, milliseconds, updatesPerSecond);
+	}
+
+	if (autogame_enabled())
+	{
+		// Leave through the normal shutdown, which waits for the file I/O threads, instead of calling exit() here.
+		replayExitStatus = desynched ? EXIT_FAILURE : EXIT_SUCCESS;
+		wzQuit();
+	}
+}
+
+int replayExitCode()
+{
+	return replayExitStatus;
+}
@@ -0,0 +1,60 @@
+/*
+	This file is part of Warzone 2100.
+	Copyright (C) 2020  Warzone 2100 Project
+
+	Warzone 2100 is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 2 of the License, or
+	(at your option) any later version.
+
+	Warzone 2100 is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Warzone 2100; if not, write to the Free Software
+	Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+/** @file replay.h
+ *  Recording multiplayer games, and setting up the same game again to play one back.
+ *
+ *  The game queue messages are recorded by lib/netplay/netreplay.h, this saves the
+ *  game settings which go with them.
+ */
+
+#ifndef __INCLUDED_SRC_REPLAY_H__
+#define __INCLUDED_SRC_REPLAY_H__
+
+#include "lib/framework/frame.h"
+
+#define REPLAY_DIR "replay"
+
+/// Whether games are recorded, stored in the config file.
+void replaySetRecording(bool enable);
+bool replayGetRecording();
+
+/// How many replays are kept in REPLAY_DIR, the oldest are deleted to make room for a new one.
+void replaySetMaxFiles(int maxFiles);
+int replayGetMaxFiles();
+
+/// Start recording the game which is about to start, into a new file in REPLAY_DIR. Does nothing if recording is turned off.
+void replayStartRecording();
+
+/// Finish recording or playing back.
+void replayStop();
+
+/// Open a replay, and set up the game settings and players it was recorded with.
+WZ_DECL_NONNULL(1) bool replayLoad(const char *fileName);
+
+/// Called by the host when starting the game, to use the random seed and structure limits of the replay.
+WZ_DECL_NONNULL(1) void replayGameStarting(uint32_t *randomSeed);
+
+/// Called every frame. When the replay has been played back to the end, logs how fast it ran and whether
+/// the simulation still matched the recorded synch checks. With --autogame, then quits, with exit code 1 on desynch.
+void replayUpdate();
+
+/// The exit code the game should quit with, EXIT_FAILURE if an --autogame replay desynched.
+int replayExitCode();
+
+#endif // __INCLUDED_SRC_REPLAY_H__
@@ -2625,6 +2625,14 @@ static void aiUpdateStructure(STRUCTURE *psStructure, bool isMission)
 	/* See if there is an enemy to attack */
 	if (psStructure->numWeaps > 0)
 	{
+		// no need to look for targets if there are no enemies near
+		int range = 0;
+		for (i = 0; i < psStructure->numWeaps; i++)
+		{
+			range = MAX(range, proj_GetLongRange(asWeaponStats + psStructure->asWeaps[i].nStat, psStructure->player));
+		}
+		bool calm = aiObjectIsCalm(psStructure, range);
+
 		//structures always update their targets
 		for (i = 0; i < psStructure->numWeaps; i++)
 		{
@@ -2632,7 +2640,11 @@ static void aiUpdateStructure(STRUCTURE *psStructure, bool isMission)
 			if (psStructure->asWeaps[i].nStat > 0 &&
 			    asWeaponStats[psStructure->asWeaps[i].nStat].weaponSubClass != WSC_LAS_SAT)
 			{
-				if (aiChooseTarget(psStructure, &psChosenObjs[i], i, true, &tmpOrigin))
+				if (calm)
+				{
+					setStructureTarget(psStructure, nullptr, i, ORIGIN_UNKNOWN);
+				}
+				else if (aiChooseTarget(psStructure, &psChosenObjs[i], i, true, &tmpOrigin))
 				{
 					objTrace(psStructure->id, "Weapon %d is targeting %d at (%d, %d)", i, psChosenObjs[i]->id,
 					         psChosenObjs[i]->pos.x, psChosenObjs[i]->pos.y);
@@ -3422,6 +3434,35 @@ static bool canSmoke(const STRUCTURE *psStruct)
 	}
 }
 
+/// Whether updating the structure would do nothing, as for walls and tank traps which aren't damaged or being built.
+static bool structureIsIdle(const STRUCTURE *psStruct)
+{
+	switch (psStruct->pStructureType->type)
+	{
+	case REF_WALL:
+	case REF_WALLCORNER:
+	case REF_DEFENSE:
+		break;
+	default:
+		return false;
+	}
+	if (psStruct->status != SS_BUILT || psStruct->numWeaps > 0 || psStruct->flags.test(OBJECT_FLAG_DIRTY)
+	    || structStandardSensor(psStruct) || structVTOLSensor(psStruct) || objRadarDetector(psStruct))
+	{
+		return false;
+	}
+	for (int i = 0; i < MAX_WEAPONS; i++)
+	{
+		if (psStruct->psTarget[i] != nullptr)
+		{
+			return false;
+		}
+	}
+	return psStruct->periodicalDamageStart == 0
+	       && psStruct->resistance >= (SWORD)structureResistance(psStruct->pStructureType, psStruct->player)
+	       && psStruct->body >= structureBody(psStruct);
+}
+
 static float CalcStructureSmokeInterval(float damage)
 {
 	return (((1. - damage) + 0.1) * 10) * STRUCTURE_DAMAGE_SCALING;
@@ -3536,6 +3577,14 @@ void structureUpdate(STRUCTURE *psBuilding, bool mission)
 	Vector3i dv;
 	int i;
 
+	if (structureIsIdle(psBuilding))
+	{
+		// Nothing to do, only keep the time up to date.
+		psBuilding->prevTime = psBuilding->time;
+		psBuilding->time = gameTime;
+		return;
+	}
+
 	syncDebugStructure(psBuilding, '<');
 
 	if (psBuilding->flags.test(OBJECT_FLAG_DIRTY) && !mission)
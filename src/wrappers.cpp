@@ -43,6 +43,7 @@
 #include "multistat.h"
 #include "warzoneconfig.h"
 #include "wrappers.h"
+#include "clparse.h"
 #include "titleui/titleui.h"
 
 struct STAR
@@ -133,7 +134,7 @@ TITLECODE titleLoop()
 		// then check --join and if neither, run the normal game menu.
 		if (hostlaunch)
 		{
-			if (hostlaunch == 2)
+			if (hostlaunch == 2 || hostlaunch == 4)
 			{
 				SPinit();
 			}
@@ -185,7 +186,10 @@ TITLECODE titleLoop()
 	audio_Update();
 
 	pie_SetFogStatus(false);
-	pie_ScreenFlip(CLEAR_BLACK);//title loop
+	if (!headless_enabled())
+	{
+		pie_ScreenFlip(CLEAR_BLACK);//title loop
+	}
 
 	if ((keyDown(KEY_LALT) || keyDown(KEY_RALT)) && keyPressed(KEY_RETURN))
 	{
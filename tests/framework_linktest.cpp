@@ -2,31 +2,7 @@
 #include "lib/framework/types.h"
 #include "lib/framework/frame.h"
 
-// --- dummy rendering library implementation ----
-
-void wzToggleFullscreen()
-{
-}
-
-bool wzIsFullscreen()
-{
-	return false;
-}
-
-void wzFatalDialog(char const*)
-{
-}
-
-int wzGetTicks()
-{
-	return 1;
-}
-
-void inputInitialise()
-{
-}
-
-// --- end linking hacks ---
+// The dummy platform library is in linktest_stubs.cpp.
 
 int main(void)
 {
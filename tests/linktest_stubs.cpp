@@ -0,0 +1,119 @@
+#include "lib/framework/wzglobal.h"
+#include "lib/framework/types.h"
+#include "lib/framework/frame.h"
+#include "lib/framework/wzapp.h"
+#include "lib/framework/input.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// --- dummy platform library implementation, shared by the tests which link libframework without lib/sdl ----
+
+void wzToggleFullscreen()
+{
+}
+
+bool wzIsFullscreen()
+{
+	return false;
+}
+
+void wzDisplayDialog(DialogType, const char *, const char *)
+{
+}
+
+int wzGetTicks()
+{
+	return 1;
+}
+
+void inputInitialise()
+{
+}
+
+struct WZ_THREAD
+{
+	std::thread thread;
+	int result;
+};
+
+struct WZ_MUTEX
+{
+	std::mutex mutex;
+};
+
+struct WZ_SEMAPHORE
+{
+	std::mutex mutex;
+	std::condition_variable cond;
+	int value;
+};
+
+WZ_THREAD *wzThreadCreate(int (*threadFunc)(void *), void *data)
+{
+	WZ_THREAD *thread = new WZ_THREAD;
+	thread->result = 0;
+	thread->thread = std::thread([thread, threadFunc, data]() { thread->result = threadFunc(data); });
+	return thread;
+}
+
+void wzThreadStart(WZ_THREAD *)
+{
+}
+
+int wzThreadJoin(WZ_THREAD *thread)
+{
+	thread->thread.join();
+	int result = thread->result;
+	delete thread;
+	return result;
+}
+
+WZ_MUTEX *wzMutexCreate()
+{
+	return new WZ_MUTEX;
+}
+
+void wzMutexDestroy(WZ_MUTEX *mutex)
+{
+	delete mutex;
+}
+
+void wzMutexLock(WZ_MUTEX *mutex)
+{
+	mutex->mutex.lock();
+}
+
+void wzMutexUnlock(WZ_MUTEX *mutex)
+{
+	mutex->mutex.unlock();
+}
+
+WZ_SEMAPHORE *wzSemaphoreCreate(int startValue)
+{
+	WZ_SEMAPHORE *semaphore = new WZ_SEMAPHORE;
+	semaphore->value = startValue;
+	return semaphore;
+}
+
+void wzSemaphoreDestroy(WZ_SEMAPHORE *semaphore)
+{
+	delete semaphore;
+}
+
+void wzSemaphoreWait(WZ_SEMAPHORE *semaphore)
+{
+	std::unique_lock<std::mutex> lock(semaphore->mutex);
+	semaphore->cond.wait(lock, [semaphore]() { return semaphore->value > 0; });
+	--semaphore->value;
+}
+
+void wzSemaphorePost(WZ_SEMAPHORE *semaphore)
+{
+	std::lock_guard<std::mutex> lock(semaphore->mutex);
+	++semaphore->value;
+	semaphore->cond.notify_one();
+}
+
+// --- end linking hacks ---
@@ -735,6 +735,13 @@ static QScriptValue js_loadLevel(QScriptContext *context, QScriptEngine *)
 	return QScriptValue();
 }
 
+static QScriptValue js_prefetchLevel(QScriptContext *context, QScriptEngine *)
+{
+	ARG_COUNT_EXACT(1);
+	ARG_STRING(0);
+	return QScriptValue(true);
+}
+
 static QScriptValue js_chat(QScriptContext *context, QScriptEngine *)
 {
 	ARG_COUNT_EXACT(2);
@@ -1006,6 +1013,7 @@ bool testPlayerScript(QString path, int player, int difficulty)
 	engine->globalObject().setProperty("setScrollParams", engine->newFunction(js_setScrollParams));
 	engine->globalObject().setProperty("addStructure", engine->newFunction(js_addStructure));
 	engine->globalObject().setProperty("loadLevel", engine->newFunction(js_loadLevel));
+	engine->globalObject().setProperty("prefetchLevel", engine->newFunction(js_prefetchLevel));
 	engine->globalObject().setProperty("setDroidExperience", engine->newFunction(js_setDroidExperience));
 	engine->globalObject().setProperty("setNoGoArea", engine->newFunction(js_setNoGoArea));
 	engine->globalObject().setProperty("setAlliance", engine->newFunction(js_setAlliance));
@@ -0,0 +1,182 @@
+#include "lib/framework/wzglobal.h"
+#include "lib/framework/types.h"
+#include "lib/framework/frame.h"
+#include "lib/framework/wzapp.h"
+#include "lib/netplay/netqueue.h"
+
+#include <algorithm>
+#include <vector>
+
+// The dummy platform library is in linktest_stubs.cpp.
+
+// Checks that NetQueue delivers messages in order and unchanged, whichever way the byte stream is split up,
+// and that the references it hands out stay valid while the message is still needed by the other side.
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "netqueuetest: %s:%d: %s failed\n", __FUNCTION__, __LINE__, #cond); return false; } } while (0)
+
+static NetMessage makeMessage(unsigned n)
+{
+	// Sizes around the boundaries of the length encoding, and an empty message.
+	static const size_t sizes[] = {0, 1, 2, 127, 128, 200, 255, 256, 1000, 16383, 16384, 70000};
+	NetMessage message(n % 256);
+	message.data.resize(sizes[n % ARRAY_SIZE(sizes)]);
+	for (size_t i = 0; i < message.data.size(); ++i)
+	{
+		message.data[i] = uint8_t(n * 7 + i);
+	}
+	return message;
+}
+
+static bool sameMessage(NetMessage const &a, NetMessage const &b)
+{
+	return a.type == b.type && a.data == b.data;
+}
+
+/// Serialises the messages in the send queue, as NETsend does.
+static std::vector<uint8_t> takeStream(NetQueue &queue)
+{
+	std::vector<uint8_t> stream;
+	while (queue.numMessagesForNet() > 0)
+	{
+		NetMessage const &message = queue.getMessageForNet();
+		uint8_t header[NetMessage::maxRawHeaderLen];
+		size_t headerLen = message.rawHeader(header);
+		stream.insert(stream.end(), header, header + headerLen);
+		stream.insert(stream.end(), message.data.begin(), message.data.end());
+		queue.popMessageForNet();
+	}
+	return stream;
+}
+
+static bool testLengthEncoding()
+{
+	static const uint32_t values[] = {0, 1, 127, 128, 255, 256, 16383, 16384, 65535, 65536, 2097151, 2097152, 0x7FFFFFFF, 0xFFFFFFFF};
+	for (uint32_t value : values)
+	{
+		unsigned length = encodedlength_uint32_t(value);
+		CHECK(length >= 1 && length <= NetMessage::maxRawHeaderLen - 1);
+		uint8_t bytes[NetMessage::maxRawHeaderLen];
+		uint32_t v = value;
+		for (unsigned n = 0; n < length; ++n)
+		{
+			bool more = encode_uint32_t(bytes[n], v, n);
+			CHECK(more == (n + 1 < length));
+		}
+		uint32_t decoded = 0;
+		for (unsigned n = 0; n < length; ++n)
+		{
+			bool more = decode_uint32_t(bytes[n], decoded, n);
+			CHECK(more == (n + 1 < length));
+		}
+		CHECK(decoded == value);
+	}
+	return true;
+}
+
+/// Every message comes out in the order it went in, for each way of cutting the stream into pieces.
+static bool testOrderAndSplits()
+{
+	static const size_t pieceSizes[] = {1, 2, 3, 7, 1400, 1000000};
+	static const unsigned numMessages = 50;
+	for (size_t pieceSize : pieceSizes)
+	{
+		NetQueuePair pair;
+		for (unsigned n = 0; n < numMessages; ++n)
+		{
+			pair.send.pushMessage(makeMessage(n));
+		}
+		CHECK(pair.send.numMessagesForNet() == numMessages);
+		std::vector<uint8_t> stream = takeStream(pair.send);
+		CHECK(pair.send.numMessagesForNet() == 0);
+
+		unsigned received = 0;
+		for (size_t pos = 0; pos < stream.size(); pos += pieceSize)
+		{
+			pair.receive.writeRawData(&stream[pos], std::min(pieceSize, stream.size() - pos));
+			for (; pair.receive.haveMessage(); ++received)
+			{
+				CHECK(received < numMessages);
+				CHECK(sameMessage(pair.receive.getMessage(), makeMessage(received)));
+				pair.receive.popMessage();
+			}
+		}
+		CHECK(received == numMessages);
+	}
+	return true;
+}
+
+/// A message is only returned once all of it has arrived, even if the stream stops inside its header.
+static bool testPartialMessage()
+{
+	NetQueuePair pair;
+	NetMessage big = makeMessage(11);  // 70000 bytes, so the length takes more than one byte.
+	pair.send.pushMessage(big);
+	std::vector<uint8_t> stream = takeStream(pair.send);
+	CHECK(stream.size() > big.data.size() + 2);
+
+	for (size_t pos = 0; pos + 1 < stream.size(); ++pos)
+	{
+		pair.receive.writeRawData(&stream[pos], 1);
+		CHECK(!pair.receive.haveMessage());
+	}
+	pair.receive.writeRawData(&stream.back(), 1);
+	CHECK(pair.receive.haveMessage());
+	CHECK(sameMessage(pair.receive.getMessage(), big));
+	pair.receive.popMessage();
+	CHECK(!pair.receive.haveMessage());
+	return true;
+}
+
+/// A game queue is both read and sent. A message which was read must stay until it is sent, and the other way
+/// around, and references to it must survive more messages being pushed.
+static bool testReferencesAfterPop()
+{
+	NetQueue queue;
+	queue.pushMessage(makeMessage(3));
+	queue.pushMessage(makeMessage(4));
+
+	NetMessage const &forNet = queue.getMessageForNet();
+	CHECK(&forNet == &queue.getMessage());
+	queue.popMessage();  // Read, but not sent yet.
+	for (unsigned n = 0; n < 1000; ++n)
+	{
+		queue.pushMessage(makeMessage(n));
+	}
+	CHECK(sameMessage(forNet, makeMessage(3)));
+	queue.popMessageForNet();
+
+	NetMessage const &read = queue.getMessage();
+	CHECK(&read == &queue.getMessageForNet());
+	queue.popMessageForNet();  // Sent, but not read yet.
+	for (unsigned n = 0; n < 1000; ++n)
+	{
+		queue.pushMessage(makeMessage(n));
+	}
+	CHECK(sameMessage(read, makeMessage(4)));
+	queue.popMessage();
+
+	CHECK(queue.numMessagesForNet() == 2000);
+	for (unsigned n = 0; n < 2000; ++n)
+	{
+		CHECK(queue.haveMessage());
+		CHECK(sameMessage(queue.getMessage(), makeMessage(n % 1000)));
+		queue.popMessage();
+	}
+	CHECK(!queue.haveMessage());
+	CHECK(queue.numMessagesForNet() == 2000);
+	return true;
+}
+
+int main(void)
+{
+	debug_init();
+	debug_register_callback(debug_callback_stderr, nullptr, nullptr, nullptr);
+
+	bool ok = testLengthEncoding();
+	ok = testOrderAndSplits() && ok;
+	ok = testPartialMessage() && ok;
+	ok = testReferencesAfterPop() && ok;
+
+	debug_exit();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "lib/framework/wzglobal.h"
+#include "lib/framework/types.h"
+#include "lib/framework/frame.h"
+#include "lib/framework/wzapp.h"
+#include "lib/netplay/netsocket.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// The dummy platform library is in linktest_stubs.cpp.
+
+// Loopback benchmark of checkSockets(): a few connections which send data every round,
+// and many idle ones. With epoll, the time per round shouldn't grow with the idle ones.
+
+static const int chattyConnections = 10;
+static const int rounds = 1000;
+
+static Socket *acceptWithTimeout(Socket *listenSocket)
+{
+	for (int i = 0; i < 1000; ++i)
+	{
+		if (Socket *sock = socketAccept(listenSocket))
+		{
+			return sock;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return nullptr;
+}
+
+static bool benchmark(Socket *listenSocket, const SocketAddress *addr, unsigned port, int idleConnections)
+{
+	std::vector<Socket *> clients, servers;
+	SocketSet *set = allocSocketSet();
+	bool ok = true;
+	for (int i = 0; ok && i < chattyConnections + idleConnections; ++i)
+	{
+		Socket *client = socketOpen(addr, 2000);
+		Socket *server = client != nullptr ? acceptWithTimeout(listenSocket) : nullptr;
+		ok = client != nullptr && server != nullptr;
+		if (client != nullptr)
+		{
+			clients.push_back(client);
+		}
+		if (server != nullptr)
+		{
+			servers.push_back(server);
+			SocketSet_AddSocket(set, server);
+		}
+	}
+	if (!ok)
+	{
+		fprintf(stderr, "Could not open %d connections on port %u\n", chattyConnections + idleConnections, port);
+	}
+
+	std::chrono::steady_clock::duration pollTime(0);
+	for (int round = 0; ok && round < rounds; ++round)
+	{
+		for (int i = 0; i < chattyConnections; ++i)
+		{
+			uint8_t byte = round;
+			writeAll(clients[i], &byte, 1);
+		}
+		int received = 0;
+		for (int timeouts = 0; ok && received < chattyConnections; )
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			int ready = checkSockets(set, 100);
+			pollTime += std::chrono::steady_clock::now() - start;
+			ok = ready != SOCKET_ERROR;
+			for (Socket *server : servers)
+			{
+				uint8_t buf[16];
+				if (ok && socketReadReady(server))
+				{
+					ssize_t size = readNoInt(server, buf, sizeof(buf));
+					ok = size >= 0;
+					received += std::max<ssize_t>(size, 0);
+				}
+			}
+			timeouts += ready == 0;
+			ok = ok && timeouts < 20;
+		}
+	}
+	if (ok)
+	{
+		printf("%d idle connections: %.1f us polling per round\n", idleConnections,
+		       std::chrono::duration<double, std::micro>(pollTime).count() / rounds);
+	}
+	else
+	{
+		fprintf(stderr, "Lost data with %d idle connections\n", idleConnections);
+	}
+
+	deleteSocketSet(set);
+	for (Socket *sock : servers)
+	{
+		socketClose(sock);
+	}
+	for (Socket *sock : clients)
+	{
+		socketClose(sock);
+	}
+	return ok;
+}
+
+int main(void)
+{
+	debug_init();
+	debug_register_callback(debug_callback_stderr, nullptr, nullptr, nullptr);
+	SOCKETinit();
+
+	// Let the system pick a free port, so the test doesn't fail when a game or another test is using one.
+	Socket *listenSocket = socketListen(0);
+	unsigned port = listenSocket != nullptr ? getSocketPort(listenSocket) : 0;
+	SocketAddress *addr = port != 0 ? resolveHost("127.0.0.1", port) : nullptr;
+	bool ok = addr != nullptr;
+	if (ok)
+	{
+		ok = benchmark(listenSocket, addr, port, 50) && benchmark(listenSocket, addr, port, 400);
+	}
+	else
+	{
+		fprintf(stderr, "Could not listen on a local port\n");
+	}
+
+	if (addr != nullptr)
+	{
+		deleteSocketAddress(addr);
+	}
+	if (listenSocket != nullptr)
+	{
+		socketClose(listenSocket);
+	}
+	SOCKETshutdown();
+	debug_exit();
+	return ok ? 0 : 1;
+}